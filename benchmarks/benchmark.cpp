@@ -0,0 +1,386 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    Development tool comparing KGeoTag's own implementations of time critical tasks with the
+    straightforward ones they replaced, both regarding the speed and the results. It's only built
+    if BUILD_BENCHMARKS is enabled, and not installed.
+
+    Usage: kgeotag_benchmark timestamps
+           kgeotag_benchmark interpolation
+           kgeotag_benchmark decoding <directory> [<size>]
+           kgeotag_benchmark timezones <timezones.bin> <timezones.geojson>
+*/
+
+// Local includes
+#include "IsoTimestamp.h"
+#include "SphericalMath.h"
+#include "ImageDecoding.h"
+#include "TimeZoneMap.h"
+#include "TimeZonePolygons.h"
+#include "KGeoTag.h"
+
+// Marble includes
+#include <marble/GeoDataCoordinates.h>
+
+// KDE includes
+#include <KExiv2/KExiv2>
+#include <KExiv2/KExiv2Previews>
+
+// Qt includes
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QDateTime>
+#include <QVector>
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QBuffer>
+#include <QImage>
+
+// C++ includes
+#include <algorithm>
+#include <cmath>
+
+static QTextStream s_out(stdout);
+
+static double milliseconds(qint64 nanoseconds)
+{
+    return nanoseconds / 1000000.0;
+}
+
+static void benchmarkTimestamps()
+{
+    // Compares our timestamp parser with QDateTime's, using some typical GPX timestamps: mostly
+    // UTC ones, some with fractions and some with an offset
+
+    QVector<QByteArray> timestamps;
+    auto time = QDateTime(QDate(2023, 1, 1), QTime(0, 0), Qt::UTC);
+    for (int i = 0; i < 100000; i++) {
+        time = time.addSecs(37);
+        if (i % 10 == 0) {
+            timestamps.append(time.toOffsetFromUtc(7200).toString(Qt::ISODate).toUtf8());
+        } else if (i % 3 == 0) {
+            timestamps.append(time.addMSecs(i % 1000).toString(Qt::ISODateWithMs).toUtf8());
+        } else {
+            timestamps.append(time.toString(Qt::ISODate).toUtf8());
+        }
+    }
+
+    QElapsedTimer timer;
+    QVector<qint64> qtResults;
+    QVector<qint64> ownResults;
+    qtResults.reserve(timestamps.count());
+    ownResults.reserve(timestamps.count());
+
+    timer.start();
+    for (const auto &timestamp : timestamps) {
+        const auto parsed = QDateTime::fromString(QString::fromUtf8(timestamp), Qt::ISODate);
+        qtResults.append(parsed.isValid() ? parsed.toMSecsSinceEpoch() : -1);
+    }
+    const auto qtTime = timer.nsecsElapsed();
+
+    timer.restart();
+    for (const auto &timestamp : timestamps) {
+        qint64 msecs;
+        ownResults.append(IsoTimestamp::parse(timestamp.constData(), timestamp.size(), msecs)
+                          ? msecs : -1);
+    }
+    const auto ownTime = timer.nsecsElapsed();
+
+    int mismatches = 0;
+    for (int i = 0; i < timestamps.count(); i++) {
+        if (qtResults.at(i) != ownResults.at(i)) {
+            mismatches++;
+        }
+    }
+
+    s_out << "Parsed " << timestamps.count() << " timestamps:\n"
+          << "    QDateTime::fromString: " << milliseconds(qtTime) << " ms\n"
+          << "    IsoTimestamp::parse: " << milliseconds(ownTime) << " ms\n"
+          << "    Mismatches: " << mismatches << '\n';
+}
+
+static void benchmarkInterpolation()
+{
+    // Compares our great circle distance and interpolation with Marble's, using random pairs of
+    // points not too far from each other, like two neighboring track points
+
+    const int count = 100000;
+    auto *random = QRandomGenerator::global();
+
+    QVector<double> fromLons(count);
+    QVector<double> fromLats(count);
+    QVector<double> fromAlts(count);
+    QVector<double> toLons(count);
+    QVector<double> toLats(count);
+    QVector<double> toAlts(count);
+    QVector<double> fractions(count);
+
+    for (int i = 0; i < count; i++) {
+        fromLons[i] = random->bounded(360.0) - 180.0;
+        fromLats[i] = random->bounded(170.0) - 85.0;
+        fromAlts[i] = random->bounded(3000.0);
+        toLons[i] = std::clamp(fromLons.at(i) + random->bounded(0.02) - 0.01, -180.0, 180.0);
+        toLats[i] = fromLats.at(i) + random->bounded(0.02) - 0.01;
+        toAlts[i] = fromAlts.at(i) + random->bounded(20.0) - 10.0;
+        fractions[i] = random->bounded(1.0);
+    }
+
+    QVector<Coordinates> results(count);
+    QVector<double> distances(count);
+
+    QElapsedTimer timer;
+
+    // Marble
+    timer.start();
+    QVector<Marble::GeoDataCoordinates> marbleResults(count);
+    QVector<double> marbleDistances(count);
+    for (int i = 0; i < count; i++) {
+        const Marble::GeoDataCoordinates from(fromLons.at(i), fromLats.at(i), fromAlts.at(i),
+                                              Marble::GeoDataCoordinates::Degree);
+        const Marble::GeoDataCoordinates to(toLons.at(i), toLats.at(i), toAlts.at(i),
+                                            Marble::GeoDataCoordinates::Degree);
+        marbleDistances[i] = from.sphericalDistanceTo(to) * KGeoTag::earthRadius;
+        marbleResults[i] = from.interpolate(to, fractions.at(i));
+    }
+    const auto marbleTime = timer.nsecsElapsed();
+
+    // Ours
+    timer.restart();
+    for (int i = 0; i < count; i++) {
+        distances[i] = SphericalMath::distance(fromLons.at(i), fromLats.at(i),
+                                               toLons.at(i), toLats.at(i));
+        results[i] = SphericalMath::interpolate(
+            Coordinates(fromLons.at(i), fromLats.at(i), fromAlts.at(i), true),
+            Coordinates(toLons.at(i), toLats.at(i), toAlts.at(i), true),
+            fractions.at(i));
+    }
+    const auto ownTime = timer.nsecsElapsed();
+
+    // Compare the results
+    double maximumPositionDeviation = 0.0;
+    double maximumAltitudeDeviation = 0.0;
+    double maximumDistanceDeviation = 0.0;
+    for (int i = 0; i < count; i++) {
+        const auto &marble = marbleResults.at(i);
+        const auto &own = results.at(i);
+        maximumPositionDeviation = std::max(maximumPositionDeviation, SphericalMath::distance(
+            own.lon(), own.lat(),
+            marble.longitude(Marble::GeoDataCoordinates::Degree),
+            marble.latitude(Marble::GeoDataCoordinates::Degree)));
+        maximumAltitudeDeviation = std::max(maximumAltitudeDeviation,
+                                            std::abs(own.alt() - marble.altitude()));
+        maximumDistanceDeviation = std::max(maximumDistanceDeviation,
+                                            std::abs(distances.at(i) - marbleDistances.at(i)));
+    }
+
+    s_out << "Calculated the distance and interpolated " << count << " points:\n"
+          << "    Marble: " << milliseconds(marbleTime) << " ms\n"
+          << "    SphericalMath: " << milliseconds(ownTime) << " ms\n"
+          << "    Maximum deviations from Marble's results: position: "
+          << maximumPositionDeviation << " m, altitude: " << maximumAltitudeDeviation
+          << " m, distance: " << maximumDistanceDeviation << " m\n";
+}
+
+static bool benchmarkDecoding(const QString &directory, int size)
+{
+    // Compares decoding all JPEG files in the given directory at full size and scaling them
+    // afterwards with decoding them downscaled and using the embedded previews
+
+    const auto files = QDir(directory).entryInfoList({ QStringLiteral("*.jpg"),
+                                                       QStringLiteral("*.jpeg"),
+                                                       QStringLiteral("*.JPG"),
+                                                       QStringLiteral("*.JPEG") },
+                                                     QDir::Files);
+    if (files.isEmpty()) {
+        s_out << "No JPEG files found in " << directory << '\n';
+        return false;
+    }
+
+    const QSize neededSize(size, size);
+    qint64 fullTime = 0;
+    qint64 scaledTime = 0;
+    qint64 previewTime = 0;
+    qint64 fullPixels = 0;
+    qint64 scaledPixels = 0;
+    int decoded = 0;
+    int previews = 0;
+    QElapsedTimer timer;
+
+    for (const auto &file : files) {
+        QFile imageFile(file.absoluteFilePath());
+        if (! imageFile.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        const auto data = ImageDecoding::readFile(imageFile);
+        if (data.isNull()) {
+            continue;
+        }
+
+        timer.start();
+        const auto full = QImage::fromData(data);
+        const auto fromFull = full.scaled(neededSize, Qt::KeepAspectRatio,
+                                          Qt::SmoothTransformation);
+        fullTime += timer.nsecsElapsed();
+        fullPixels = std::max(fullPixels, qint64(full.width()) * full.height());
+
+        timer.restart();
+        QBuffer buffer;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+        const auto scaled = ImageDecoding::decodeScaled(&buffer, neededSize);
+        scaledTime += timer.nsecsElapsed();
+        scaledPixels = std::max(scaledPixels, qint64(scaled.width()) * scaled.height());
+
+        timer.restart();
+        KExiv2Iface::KExiv2Previews embedded(data);
+        if (! ImageDecoding::embeddedPreview(embedded, neededSize).isNull()) {
+            previews++;
+        }
+        previewTime += timer.nsecsElapsed();
+
+        if (! fromFull.isNull() && ! scaled.isNull()) {
+            decoded++;
+        }
+    }
+
+    if (decoded == 0) {
+        s_out << "Could not decode any of the JPEG files in " << directory << '\n';
+        return false;
+    }
+
+    s_out << "Decoded " << decoded << " JPEG files for a " << size << " px preview, average per "
+          << "image:\n"
+          << "    Full decode and scaling: " << milliseconds(fullTime) / decoded << " ms, "
+          << "largest image: " << fullPixels * 4 / 1048576.0 << " MiB\n"
+          << "    Downscaled decode: " << milliseconds(scaledTime) / decoded << " ms, "
+          << "largest image: " << scaledPixels * 4 / 1048576.0 << " MiB\n"
+          << "    Embedded preview: " << milliseconds(previewTime) / decoded << " ms, "
+          << "usable for " << previews << " images\n";
+
+    return true;
+}
+
+static bool benchmarkTimeZones(const QString &dataFile, const QString &polygonsFile)
+{
+    // Compares the raster and the polygon timezone lookup for random points covered by the
+    // polygons
+
+    TimeZoneMap timeZoneMap;
+    if (! timeZoneMap.loadCompiled(dataFile)) {
+        s_out << "Could not load the compiled timezone data from " << dataFile << '\n';
+        return false;
+    }
+
+    TimeZonePolygons polygons;
+    QVector<QByteArray> polygonZoneIds;
+    if (! polygons.load(polygonsFile, polygonZoneIds)) {
+        s_out << "Could not load the timezone polygons from " << polygonsFile << '\n';
+        return false;
+    }
+
+    // The polygons possibly only cover a small region, so we limit the number of tries to find
+    // points inside of them
+    const int wanted = 100000;
+    const int maximumAttempts = wanted * 100;
+    auto *random = QRandomGenerator::global();
+    QVector<double> lons;
+    QVector<double> lats;
+    lons.reserve(wanted);
+    lats.reserve(wanted);
+    for (int attempt = 0; attempt < maximumAttempts && lons.count() < wanted; attempt++) {
+        const double lon = random->bounded(360.0) - 180.0;
+        const double lat = random->bounded(170.0) - 85.0;
+        if (polygons.zoneIndex(lon, lat) != -1) {
+            lons.append(lon);
+            lats.append(lat);
+        }
+    }
+
+    const int count = lons.count();
+    if (count == 0) {
+        s_out << "No random point hit any of the timezone polygons\n";
+        return false;
+    }
+
+    QVector<int> rasterIndices(count);
+    QVector<int> polygonIndices(count);
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int i = 0; i < count; i++) {
+        rasterIndices[i] = timeZoneMap.zoneIndex(lons.at(i), lats.at(i));
+    }
+    const auto rasterTime = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < count; i++) {
+        polygonIndices[i] = polygons.zoneIndex(lons.at(i), lats.at(i));
+    }
+    const auto polygonTime = timer.nsecsElapsed();
+
+    int differing = 0;
+    for (int i = 0; i < count; i++) {
+        if (timeZoneMap.zoneId(rasterIndices.at(i))
+            != polygonZoneIds.value(polygonIndices.at(i))) {
+
+            differing++;
+        }
+    }
+
+    s_out << "Looked up " << count << " random points covered by " << polygons.count()
+          << " timezone polygons:\n"
+          << "    Raster: " << rasterTime / double(count) << " ns per point\n"
+          << "    Polygons: " << polygonTime / double(count) << " ns per point\n"
+          << "    The raster returned another timezone for " << differing << " points ("
+          << differing * 100.0 / count << " %)\n";
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QTextStream err(stderr);
+
+    const auto arguments = QCoreApplication::arguments();
+    const auto benchmark = arguments.value(1);
+
+    // Exiv2 has to be initialized before it's used
+    KExiv2Iface::KExiv2::initializeExiv2();
+
+    bool success = true;
+    if (benchmark == QStringLiteral("timestamps") && arguments.count() == 2) {
+        benchmarkTimestamps();
+    } else if (benchmark == QStringLiteral("interpolation") && arguments.count() == 2) {
+        benchmarkInterpolation();
+    } else if (benchmark == QStringLiteral("decoding")
+               && (arguments.count() == 3 || arguments.count() == 4)) {
+        // The size defaults to KGeoTag's default preview size
+        bool okay = true;
+        const int size = arguments.count() == 4 ? arguments.at(3).toInt(&okay) : 400;
+        if (! okay || size <= 0) {
+            err << "Invalid size " << arguments.at(3) << '\n';
+            success = false;
+        } else {
+            success = benchmarkDecoding(arguments.at(2), size);
+        }
+    } else if (benchmark == QStringLiteral("timezones") && arguments.count() == 4) {
+        success = benchmarkTimeZones(arguments.at(2), arguments.at(3));
+    } else {
+        err << "Usage: " << arguments.at(0) << " timestamps\n"
+            << "       " << arguments.at(0) << " interpolation\n"
+            << "       " << arguments.at(0) << " decoding <directory> [<size>]\n"
+            << "       " << arguments.at(0) << " timezones <timezones.bin> <timezones.geojson>\n";
+        success = false;
+    }
+
+    KExiv2Iface::KExiv2::cleanupExiv2();
+    s_out.flush();
+
+    return success ? 0 : 1;
+}
@@ -122,6 +122,17 @@ AutomaticMatchingWidget::AutomaticMatchingWidget(Settings *settings, QWidget *pa
 
     boundariesWrapperLayout->addStretch();
 
+    for (auto *checkBox : { m_enableMaximumInterpolationInterval,
+                            m_enableMaximumInterpolationDistance }) {
+        connect(checkBox, &QCheckBox::toggled,
+                this, &AutomaticMatchingWidget::matchParametersChanged);
+    }
+    for (auto *spinBox : { m_exactMatchTolerance, m_maximumInterpolationInterval,
+                           m_maximumInterpolationDistance }) {
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+                this, &AutomaticMatchingWidget::matchParametersChanged);
+    }
+
     // Bottom buttons
 
     layout->addStretch();
@@ -32,6 +32,7 @@ public:
 
 Q_SIGNALS:
     void requestReassignment(KGeoTag::SearchType searchType);
+    void matchParametersChanged();
 
 private Q_SLOTS:
     void enableMaximumInterpolationInterval(bool state);
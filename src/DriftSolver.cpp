@@ -0,0 +1,249 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    The DriftSolver estimates the camera's clock deviation using images whose position is already
+    known (because they already had coordinates when they were loaded, or because they have been
+    placed manually).
+
+    First, each track point passing by close to such an image votes for the deviation it would
+    take to match the image to it. Only the deviations most images agree upon are then checked
+    second by second, by comparing the images' positions with the track positions at their
+    shifted times. This way, the whole range of possible deviations can be searched without
+    matching all images for each second of it.
+*/
+
+// Local includes
+#include "DriftSolver.h"
+#include "SphericalMath.h"
+#include "KGeoTag.h"
+#include "Logging.h"
+#include "debugMode.h"
+
+// Qt includes
+#include <QDebug>
+#include <QHash>
+#include <QPair>
+
+#ifdef DEBUG_MODE
+#include <QElapsedTimer>
+#endif
+
+// C++ includes
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+// Size of the grid cells used to find track points close to an image (about 200 m). This is the
+// latitude span; the longitude span is widened according to the latitude.
+static constexpr double s_cellSize = 0.002;
+
+// Limits the widening of the cells near the poles
+static constexpr double s_minimumCellScale = 0.01;
+
+// Deviations within this interval (in milliseconds) count as agreeing with each other
+static constexpr qint64 s_votingWindow = 120000;
+
+// Number of agreed-upon deviations checked second by second
+static constexpr int s_candidatesCount = 3;
+
+// Larger distances (in meters) between an image and the track are counted as this one, so that
+// single images not fitting at all don't outweigh the others
+static constexpr double s_maximumDistance = 1000.0;
+
+static int latCell(double lat)
+{
+    return int(std::floor(lat / s_cellSize));
+}
+
+static int lonCell(double lon, int row)
+{
+    // A degree of longitude gets shorter towards the poles, so the cells are widened by
+    // 1 / cos(latitude) to cover about the same distance east-west as north-south. All cells of
+    // a row have the same width, so that points are sorted in consistently.
+    const double lat = (row + 0.5) * s_cellSize * KGeoTag::pi / 180.0;
+    const double width = s_cellSize / std::max(std::cos(lat), s_minimumCellScale);
+    return int(std::floor(lon / width));
+}
+
+static quint64 cellKey(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
+
+DriftSolver::DriftSolver(const TrackMatcher &matcher, const QVector<TrackPoints> &trackPoints)
+    : m_matcher(matcher),
+      m_trackPoints(trackPoints)
+{
+}
+
+DriftSolver::Result DriftSolver::solve(const QVector<qint64> &times,
+                                       const QVector<Coordinates> &coordinates,
+                                       int maximumDeviation) const
+{
+#ifdef DEBUG_MODE
+    QElapsedTimer timer;
+    timer.start();
+#endif
+
+    // Sort all track points into a grid
+
+    QHash<quint64, QVector<qint64>> grid;
+    for (const auto &trackPoints : m_trackPoints) {
+        for (int i = 0; i < trackPoints.count(); i++) {
+            const auto point = trackPoints.coordinates(i);
+            const int y = latCell(point.lat());
+            grid[cellKey(lonCell(point.lon(), y), y)].append(trackPoints.time(i));
+        }
+    }
+
+    // Collect the deviations suggested by the points close to each image
+
+    const qint64 maximumVote = qint64(maximumDeviation) * 1000;
+    QVector<QPair<qint64, int>> votes;
+    for (int i = 0; i < times.count(); i++) {
+        // The neighboring rows can have other cell widths, so we look up the column in each one
+        const int y = latCell(coordinates.at(i).lat());
+        for (int dy = -1; dy <= 1; dy++) {
+            const int x = lonCell(coordinates.at(i).lon(), y + dy);
+            for (int dx = -1; dx <= 1; dx++) {
+                const auto pointTimes = grid.constFind(cellKey(x + dx, y + dy));
+                if (pointTimes == grid.constEnd()) {
+                    continue;
+                }
+                for (const auto time : *pointTimes) {
+                    const auto deviation = time - times.at(i);
+                    if (std::abs(deviation) <= maximumVote) {
+                        votes.append(qMakePair(deviation, i));
+                    }
+                }
+            }
+        }
+    }
+
+    if (votes.isEmpty()) {
+        return Result();
+    }
+
+    // Slide a window over the sorted deviations and count how many different images agree on
+    // the deviations inside it
+
+    std::sort(votes.begin(), votes.end());
+
+    QVector<int> imageVotes(times.count(), 0);
+    int agreeingImages = 0;
+    int start = 0;
+    QVector<QPair<int, qint64>> windows;
+
+    for (int end = 0; end < votes.count(); end++) {
+        if (imageVotes[votes.at(end).second]++ == 0) {
+            agreeingImages++;
+        }
+        while (votes.at(end).first - votes.at(start).first > s_votingWindow) {
+            if (--imageVotes[votes.at(start).second] == 0) {
+                agreeingImages--;
+            }
+            start++;
+        }
+        windows.append(qMakePair(agreeingImages,
+                                 (votes.at(start).first + votes.at(end).first) / 2));
+    }
+
+    std::sort(windows.begin(), windows.end(), std::greater<QPair<int, qint64>>());
+
+    QVector<qint64> candidates;
+    for (const auto &window : windows) {
+        if (std::none_of(candidates.constBegin(), candidates.constEnd(),
+                         [&window](qint64 candidate)
+                         {
+                             return std::abs(candidate - window.second) <= s_votingWindow;
+                         })) {
+
+            candidates.append(window.second);
+            if (candidates.count() == s_candidatesCount) {
+                break;
+            }
+        }
+    }
+
+    // Check each second around the candidates (the camera clock deviation is set in seconds)
+
+    QVector<int> lowerBounds(times.count(), 0);
+    double bestCost = std::numeric_limits<double>::max();
+    int bestDeviation = 0;
+
+    for (const auto candidate : candidates) {
+        const int first = int(std::max((candidate - s_votingWindow) / 1000,
+                                       qint64(-maximumDeviation)));
+        const int last = int(std::min((candidate + s_votingWindow) / 1000,
+                                      qint64(maximumDeviation)));
+        for (int deviation = first; deviation <= last; deviation++) {
+            const double currentCost = cost(times, coordinates, lowerBounds, deviation, nullptr);
+            if (currentCost < bestCost) {
+                bestCost = currentCost;
+                bestDeviation = deviation;
+            }
+        }
+    }
+
+    // Collect some information about the result
+
+    QVector<double> distances(times.count());
+    cost(times, coordinates, lowerBounds, bestDeviation, &distances);
+
+    Result result;
+    result.deviation = bestDeviation;
+    result.anchors = std::count_if(distances.constBegin(), distances.constEnd(),
+                                   [](double distance)
+                                   {
+                                       return distance < s_maximumDistance;
+                                   });
+    result.found = result.anchors > 0;
+
+    auto median = distances.begin() + distances.count() / 2;
+    std::nth_element(distances.begin(), median, distances.end());
+    result.medianDistance = *median;
+
+#ifdef DEBUG_MODE
+    qCDebug(KGeoTagLog) << "Estimated a camera clock deviation of" << result.deviation
+                        << "seconds from" << times.count() << "images in"
+                        << timer.nsecsElapsed() / 1000000.0 << "ms (" << votes.count()
+                        << "votes," << candidates.count() << "candidates)";
+#endif
+
+    return result;
+}
+
+double DriftSolver::cost(const QVector<qint64> &times, const QVector<Coordinates> &coordinates,
+                         QVector<int> &lowerBounds, int deviation,
+                         QVector<double> *distances) const
+{
+    // The mean distance between the images' positions and the track positions at their shifted
+    // times. The time index positions of the last call are used as a starting point, as the
+    // deviation is changed second by second.
+
+    double sum = 0.0;
+
+    for (int i = 0; i < times.count(); i++) {
+        const auto time = times.at(i) + qint64(deviation) * 1000;
+        lowerBounds[i] = m_matcher.lowerBound(time, lowerBounds.at(i));
+        const auto position = m_matcher.interpolatedCoordinates(time, lowerBounds.at(i));
+
+        double distance = s_maximumDistance;
+        if (position.isSet()) {
+            const auto &image = coordinates.at(i);
+            distance = std::min(SphericalMath::distance(image.lon(), image.lat(),
+                                                        position.lon(), position.lat()),
+                                s_maximumDistance);
+        }
+
+        if (distances != nullptr) {
+            (*distances)[i] = distance;
+        }
+        sum += distance;
+    }
+
+    return sum / times.count();
+}
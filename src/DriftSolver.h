@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef DRIFTSOLVER_H
+#define DRIFTSOLVER_H
+
+// Local includes
+#include "Coordinates.h"
+#include "TrackMatcher.h"
+#include "TrackPoints.h"
+
+// Qt includes
+#include <QVector>
+
+class DriftSolver
+{
+
+public:
+    struct Result
+    {
+        bool found = false;
+        int deviation = 0;
+        int anchors = 0;
+        double medianDistance = 0.0;
+    };
+
+    explicit DriftSolver(const TrackMatcher &matcher, const QVector<TrackPoints> &trackPoints);
+    DriftSolver::Result solve(const QVector<qint64> &times, const QVector<Coordinates> &coordinates,
+                              int maximumDeviation) const;
+
+private: // Functions
+    double cost(const QVector<qint64> &times, const QVector<Coordinates> &coordinates,
+                QVector<int> &lowerBounds, int deviation, QVector<double> *distances) const;
+
+private: // Variables
+    TrackMatcher m_matcher;
+    QVector<TrackPoints> m_trackPoints;
+
+};
+
+#endif // DRIFTSOLVER_H
@@ -14,6 +14,7 @@
 #include <QCheckBox>
 #include <QGroupBox>
 #include <QComboBox>
+#include <QPushButton>
 
 // KDE includes
 #include <KLocalizedString>
@@ -63,6 +64,16 @@ FixDriftWidget::FixDriftWidget(QWidget *parent) : QWidget(parent)
         m_timeZone->setCurrentIndex(systemIndex);
     }
 
+    m_trackTimeZones = new QCheckBox(i18n("Use the timezone of the track portion an image was "
+                                          "taken in"));
+    m_trackTimeZones->setToolTip(i18n("If the loaded tracks cross timezone borders, interpret "
+                                      "each image's date in the timezone of the track portion "
+                                      "recorded at that time. The timezone set above is only "
+                                      "used for images not covered by any track."));
+    m_trackTimeZones->setChecked(true);
+    timeZoneBoxLayout->addWidget(m_trackTimeZones);
+    connect(m_trackTimeZones, &QCheckBox::toggled, this, &FixDriftWidget::imagesTimeZoneChanged);
+
     auto *driftBox = new QGroupBox(i18n("Camera clock time drift"));
     auto *driftBoxLayout = new QVBoxLayout(driftBox);
     layout->addWidget(driftBox);
@@ -101,6 +112,14 @@ FixDriftWidget::FixDriftWidget(QWidget *parent) : QWidget(parent)
 
     deviationLayout->addStretch();
 
+    auto *estimateButton = new QPushButton(i18n("Estimate from tagged images"));
+    estimateButton->setToolTip(i18n("Find the deviation that fits best to the images that already "
+                                    "had coordinates when they were loaded or that have been "
+                                    "placed manually"));
+    driftBoxLayout->addWidget(estimateButton);
+    connect(estimateButton, &QPushButton::clicked,
+            this, &FixDriftWidget::requestDeviationEstimation);
+
     m_displayFixed = new QCheckBox(i18n("Display the fixed dates and times"));
     m_displayFixed->setChecked(true);
     driftBoxLayout->addWidget(m_displayFixed);
@@ -109,6 +128,12 @@ FixDriftWidget::FixDriftWidget(QWidget *parent) : QWidget(parent)
     m_save = new QCheckBox(i18n("Fix the files' dates and times when saving"));
     driftBoxLayout->addWidget(m_save);
 
+    m_liveMatching = new QCheckBox(i18n("Update automatic matches while changing the drift"));
+    m_liveMatching->setToolTip(i18n("Re-match all images that are not tagged manually each time "
+                                    "the time zone or the camera clock deviation is changed"));
+    driftBoxLayout->addWidget(m_liveMatching);
+    connect(m_liveMatching, &QCheckBox::toggled, this, &FixDriftWidget::liveMatchingToggled);
+
     layout->addStretch();
 }
 
@@ -119,6 +144,24 @@ int FixDriftWidget::cameraClockDeviation() const
            + m_driftSeconds->value();
 }
 
+void FixDriftWidget::setCameraClockDeviation(int deviation)
+{
+    // Set all spin boxes at once, so that the change is only announced once
+    for (auto *spinBox : { m_driftHours, m_driftMinutes, m_driftSeconds }) {
+        spinBox->blockSignals(true);
+    }
+
+    m_driftHours->setValue(deviation / 3600);
+    m_driftMinutes->setValue(deviation % 3600 / 60);
+    m_driftSeconds->setValue(deviation % 60);
+
+    for (auto *spinBox : { m_driftHours, m_driftMinutes, m_driftSeconds }) {
+        spinBox->blockSignals(false);
+    }
+
+    Q_EMIT cameraDriftSettingsChanged();
+}
+
 bool FixDriftWidget::save() const
 {
     return m_save->isChecked();
@@ -149,3 +192,13 @@ bool FixDriftWidget::displayFixed() const
 {
     return m_displayFixed->isChecked();
 }
+
+bool FixDriftWidget::liveMatching() const
+{
+    return m_liveMatching->isChecked();
+}
+
+bool FixDriftWidget::trackTimeZones() const
+{
+    return m_trackTimeZones->isChecked();
+}
@@ -21,8 +21,11 @@ class FixDriftWidget : public QWidget
 public:
     explicit FixDriftWidget(QWidget *parent = nullptr);
     int cameraClockDeviation() const;
+    void setCameraClockDeviation(int deviation);
     bool save() const;
     bool displayFixed() const;
+    bool liveMatching() const;
+    bool trackTimeZones() const;
     QByteArray imagesTimeZoneId() const;
     const QTimeZone &imagesTimeZone() const;
     bool setImagesTimeZone(const QByteArray &id);
@@ -30,14 +33,18 @@ public:
 Q_SIGNALS:
     void imagesTimeZoneChanged();
     void cameraDriftSettingsChanged();
+    void liveMatchingToggled(bool state);
+    void requestDeviationEstimation();
 
 private: // Variables
     QComboBox *m_timeZone;
+    QCheckBox *m_trackTimeZones;
     QSpinBox *m_driftHours;
     QSpinBox *m_driftMinutes;
     QSpinBox *m_driftSeconds;
     QCheckBox *m_displayFixed;
     QCheckBox *m_save;
+    QCheckBox *m_liveMatching;
     QTimeZone m_imagesTimeZone;
 
 };
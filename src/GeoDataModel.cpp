@@ -6,6 +6,7 @@
 #include "GeoDataModel.h"
 #include "KGeoTag.h"
 #include "MimeHelper.h"
+#include "TimeZoneMap.h"
 
 // Marble includes
 #include <marble/GeoDataCoordinates.h>
@@ -45,45 +46,25 @@ bool GeoDataModel::contains(const QString &path)
     return m_loadedFiles.contains(canonicalPath(path));
 }
 
-void GeoDataModel::addTrack(const QString &path, const QVector<QVector<QDateTime>> &times,
-                            const QVector<QVector<Coordinates>> &segments)
+void GeoDataModel::addTrack(const QString &path, const TrackPoints &trackPoints,
+                            const TrackTimeZones &trackTimeZones)
 {
+    // We only keep the track's bounding box. The line strings Marble needs to draw the track are
+    // built from the track points when rendering (cf. TracksLayer).
+    const auto &lons = trackPoints.lons();
+    const auto &lats = trackPoints.lats();
+    const auto [ west, east ] = std::minmax_element(lons.constBegin(), lons.constEnd());
+    const auto [ south, north ] = std::minmax_element(lats.constBegin(), lats.constEnd());
     Marble::GeoDataLatLonAltBox marbleTrackBox;
-    QVector<Marble::GeoDataLineString> marbleTracks;
+    marbleTrackBox.setBoundaries(*north, *south, *east, *west, Marble::GeoDataCoordinates::Degree);
 
-    QVector<QDateTime> dateTimes;
-    QHash<QDateTime, Coordinates> trackPoints;
-
-    for (int i = 0; i < times.count(); i++) {
-        Marble::GeoDataLineString lineString;
-
-        for (int j = 0; j < times.at(i).count(); j++) {
-            const auto &coordinates = segments.at(i).at(j);
-            const Marble::GeoDataCoordinates marbleCoordinates
-                = Marble::GeoDataCoordinates(coordinates.lon(), coordinates.lat(), 0.0,
-                                            Marble::GeoDataCoordinates::Degree);
-            lineString.append(marbleCoordinates);
-
-            const auto &dateTime = times.at(i).at(j);
-            dateTimes.append(dateTime);
-            trackPoints[dateTime] = coordinates;
-        }
-
-        const auto box = lineString.latLonAltBox();
-        if (marbleTrackBox.isEmpty()) {
-            marbleTrackBox = box;
-        } else {
-            marbleTrackBox |= box;
-        }
-        marbleTracks.append(lineString);
-    }
-
-    m_marbleTracks.append(marbleTracks);
-    m_marbleTrackBoxes.append(marbleTrackBox);
-
-    std::sort(dateTimes.begin(), dateTimes.end());
-    m_dateTimes.append(dateTimes);
+    m_timeIndex.addTrack(m_trackPoints.count(), trackPoints);
     m_trackPoints.append(trackPoints);
+    TrackGaps trackGaps(trackPoints);
+    trackGaps.setLimits(m_maximumInterpolationInterval, m_maximumInterpolationDistance);
+    m_trackGaps.append(trackGaps);
+    m_trackTimeZones.append(trackTimeZones);
+    m_marbleTrackBoxes.append(marbleTrackBox);
 
     m_loadedFiles.append(canonicalPath(path));
     const QFileInfo info(path);
@@ -99,10 +80,11 @@ void GeoDataModel::removeTrack(int row)
     const auto modelIndex = index(row, 0);
     m_loadedFiles.remove(row);
     m_displayFileNames.remove(row);
-    m_marbleTracks.remove(row);
-    m_marbleTrackBoxes.remove(row);
-    m_dateTimes.remove(row);
     m_trackPoints.remove(row);
+    m_timeIndex.removeTrack(row);
+    m_trackGaps.remove(row);
+    m_trackTimeZones.remove(row);
+    m_marbleTrackBoxes.remove(row);
     Q_EMIT dataChanged(modelIndex, modelIndex, { Qt::DisplayRole });
     endRemoveRows();
 }
@@ -115,10 +97,11 @@ void GeoDataModel::removeAllTracks()
     beginRemoveRows(QModelIndex(), 0, lastRow);
     m_loadedFiles.clear();
     m_displayFileNames.clear();
-    m_marbleTracks.clear();
-    m_marbleTrackBoxes.clear();
-    m_dateTimes.clear();
     m_trackPoints.clear();
+    m_timeIndex.clear();
+    m_trackGaps.clear();
+    m_trackTimeZones.clear();
+    m_marbleTrackBoxes.clear();
     Q_EMIT dataChanged(firstModelIndex, lastModelIndex, { Qt::DisplayRole });
     endRemoveRows();
 }
@@ -148,19 +131,60 @@ Marble::GeoDataLatLonAltBox GeoDataModel::trackBox(const QModelIndex &index) con
     return m_marbleTrackBoxes.at(index.row());
 }
 
-const QVector<QVector<Marble::GeoDataLineString>> &GeoDataModel::marbleTracks() const
+const QVector<TrackPoints> &GeoDataModel::trackPoints() const
 {
-    return m_marbleTracks;
+    return m_trackPoints;
 }
 
-const QVector<QVector<QDateTime>> &GeoDataModel::dateTimes() const
+const TimeIndex &GeoDataModel::timeIndex() const
 {
-    return m_dateTimes;
+    return m_timeIndex;
 }
 
-const QVector<QHash<QDateTime, Coordinates>> &GeoDataModel::trackPoints() const
+const QVector<TrackGaps> &GeoDataModel::trackGaps() const
 {
-    return m_trackPoints;
+    return m_trackGaps;
+}
+
+const QVector<TrackTimeZones> &GeoDataModel::trackTimeZones() const
+{
+    return m_trackTimeZones;
+}
+
+void GeoDataModel::addMissingTrackTimeZones(const TimeZoneMap &timeZoneMap)
+{
+    // Tracks added before the timezone data was ready don't have any timezones yet. Tracks
+    // without time information will simply get empty ones again.
+    for (int i = 0; i < m_trackTimeZones.count(); i++) {
+        if (m_trackTimeZones.at(i).count() == 0) {
+            m_trackTimeZones[i] = TrackTimeZones(m_trackPoints.at(i), timeZoneMap);
+        }
+    }
+}
+
+void GeoDataModel::updateTrackTimeZones(const TimeZoneMap &timeZoneMap)
+{
+    // Looks up the timezones of all tracks again, e.g. after the exact timezone borders have been
+    // enabled or disabled
+    for (int i = 0; i < m_trackTimeZones.count(); i++) {
+        m_trackTimeZones[i] = TrackTimeZones(m_trackPoints.at(i), timeZoneMap);
+    }
+}
+
+void GeoDataModel::setInterpolationLimits(int maximumInterval, int maximumDistance)
+{
+    if (maximumInterval == m_maximumInterpolationInterval
+        && maximumDistance == m_maximumInterpolationDistance) {
+
+        return;
+    }
+
+    m_maximumInterpolationInterval = maximumInterval;
+    m_maximumInterpolationDistance = maximumDistance;
+
+    for (auto &trackGaps : m_trackGaps) {
+        trackGaps.setLimits(maximumInterval, maximumDistance);
+    }
 }
 
 Qt::DropActions GeoDataModel::supportedDropActions() const
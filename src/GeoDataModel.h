@@ -7,15 +7,19 @@
 
 // Local includes
 #include "Coordinates.h"
+#include "TrackPoints.h"
+#include "TimeIndex.h"
+#include "TrackGaps.h"
+#include "TrackTimeZones.h"
 
 // Marble includes
-#include <marble/GeoDataLineString.h>
 #include <marble/GeoDataLatLonAltBox.h>
 
 // Qt includes
 #include <QAbstractListModel>
-#include <QHash>
-#include <QDateTime>
+
+// Local classes
+class TimeZoneMap;
 
 class GeoDataModel : public QAbstractListModel
 {
@@ -34,17 +38,21 @@ public:
                       const QModelIndex &) override;
 
     bool contains(const QString &path);
-    void addTrack(const QString &path, const QVector<QVector<QDateTime>> &times,
-                  const QVector<QVector<Coordinates>> &segments);
+    void addTrack(const QString &path, const TrackPoints &trackPoints,
+                  const TrackTimeZones &trackTimeZones);
     void removeTrack(int row);
     void removeAllTracks();
     Marble::GeoDataLatLonAltBox trackBox(const QString &path) const;
     Marble::GeoDataLatLonAltBox trackBox(const QModelIndex &index) const;
     Coordinates trackBoxCenter(const QString &path) const;
+    void setInterpolationLimits(int maximumInterval, int maximumDistance);
+    void addMissingTrackTimeZones(const TimeZoneMap &timeZoneMap);
+    void updateTrackTimeZones(const TimeZoneMap &timeZoneMap);
 
-    const QVector<QVector<Marble::GeoDataLineString>> &marbleTracks() const;
-    const QVector<QVector<QDateTime>> &dateTimes() const;
-    const QVector<QHash<QDateTime, Coordinates>> &trackPoints() const;
+    const QVector<TrackPoints> &trackPoints() const;
+    const TimeIndex &timeIndex() const;
+    const QVector<TrackGaps> &trackGaps() const;
+    const QVector<TrackTimeZones> &trackTimeZones() const;
 
 Q_SIGNALS:
     void requestAddFiles(const QVector<QString> &paths);
@@ -56,11 +64,14 @@ private: // Variables
     QVector<QString> m_loadedFiles;
     QVector<QString> m_displayFileNames;
 
-    QVector<QVector<Marble::GeoDataLineString>> m_marbleTracks;
-    QVector<Marble::GeoDataLatLonAltBox> m_marbleTrackBoxes;
+    QVector<TrackPoints> m_trackPoints;
+    TimeIndex m_timeIndex;
+    QVector<TrackGaps> m_trackGaps;
+    QVector<TrackTimeZones> m_trackTimeZones;
+    int m_maximumInterpolationInterval = -1;
+    int m_maximumInterpolationDistance = -1;
 
-    QVector<QVector<QDateTime>> m_dateTimes;
-    QVector<QHash<QDateTime, Coordinates>> m_trackPoints;
+    QVector<Marble::GeoDataLatLonAltBox> m_marbleTrackBoxes;
 
 };
 
@@ -5,27 +5,30 @@
 // Local includes
 
 #include "GpxEngine.h"
+#include "GpxScanner.h"
 #include "GeoDataModel.h"
+#include "IsoTimestamp.h"
+#include "TrackCache.h"
+#include "TrackMatcher.h"
+#include "TrackTimeZones.h"
 #include "Logging.h"
 
 #include "debugMode.h"
 
-// Marble includes
-#include <marble/GeoDataCoordinates.h>
-
 // Qt includes
 
 #include <QDebug>
 #include <QFile>
 #include <QXmlStreamReader>
-#include <QJsonDocument>
 #include <QStandardPaths>
 #include <QFile>
 #include <QLoggingCategory>
-#include <QTimeZone>
+#include <QFileInfo>
+#include <QtConcurrentRun>
 
-// C++ includes
-#include <cmath>
+#ifdef DEBUG_MODE
+#include <QElapsedTimer>
+#endif
 
 static const auto s_gpx    = QStringLiteral("gpx");
 static const auto s_trk    = QStringLiteral("trk");
@@ -36,83 +39,238 @@ static const auto s_ele    = QStringLiteral("ele");
 static const auto s_time   = QStringLiteral("time");
 static const auto s_trkseg = QStringLiteral("trkseg");
 
-GpxEngine::GpxEngine(QObject *parent, GeoDataModel *geoDataModel)
-    : QObject(parent),
-      m_geoDataModel(geoDataModel)
+const QString GpxEngine::timeZonePolygonsFile = QStringLiteral("timezones.geojson");
+
+static QString timeZonePolygonsFile()
 {
-    // Load the timezone map image
-    const auto timezoneMapFile = QStandardPaths::locate(QStandardPaths::AppDataLocation,
-                                                        QStringLiteral("timezones.png"));
-    if (! timezoneMapFile.isEmpty()) {
-        m_timezoneMap = QImage(timezoneMapFile);
-        if (! m_timezoneMap.isNull()) {
-            m_timezoneMapWidth = m_timezoneMap.size().width();
-            m_timezoneMapHeight = m_timezoneMap.size().height();
+    return QStandardPaths::locate(QStandardPaths::AppDataLocation,
+                                  GpxEngine::timeZonePolygonsFile);
+}
+
+static TimeZoneMap loadTimeZoneMap(bool exactBorders)
+{
+    TimeZoneMap timeZoneMap;
+
+    // Use the data compiled during the build if possible. Otherwise, fall back to converting the
+    // map image.
+
+    const auto compiledDataFile = QStandardPaths::locate(QStandardPaths::AppDataLocation,
+                                                         QStringLiteral("timezones.bin"));
+    if (compiledDataFile.isEmpty() || ! timeZoneMap.loadCompiled(compiledDataFile)) {
+        const auto timezoneMapFile = QStandardPaths::locate(QStandardPaths::AppDataLocation,
+                                                            QStringLiteral("timezones.png"));
+        const auto timezoneMappingFile = QStandardPaths::locate(QStandardPaths::AppDataLocation,
+                                                                QStringLiteral("timezones.json"));
+        if (timezoneMapFile.isEmpty() || timezoneMappingFile.isEmpty()
+            || ! timeZoneMap.load(timezoneMapFile, timezoneMappingFile)) {
+
+            // This should not happen
+            qCWarning(KGeoTagLog) << "Failed to load the timezone data!";
+            return timeZoneMap;
         }
-        qCDebug(KGeoTagLog) << "Loaded the timezones map from" << timezoneMapFile;
-    } else {
-        // This should not happen
-        qCDebug(KGeoTagLog) << "Failed to load the timezones map file!";
     }
 
-    // Load the color-timezone mapping
-    const auto timezoneMappingFile = QStandardPaths::locate(QStandardPaths::AppDataLocation,
-                                                            QStringLiteral("timezones.json"));
-    if (! timezoneMappingFile.isEmpty()) {
-        QFile jsonData(timezoneMappingFile);
-        if (jsonData.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            const auto jsonDocument = QJsonDocument::fromJson(jsonData.readAll());
-            jsonData.close();
-            m_timezoneMapping = jsonDocument.object();
+    // Add the polygons for exact borders if requested. They are not shipped, so we simply keep
+    // using the map alone if they can't be found.
+    if (exactBorders) {
+        const auto polygonsFile = timeZonePolygonsFile();
+        if (polygonsFile.isEmpty()) {
+            qCWarning(KGeoTagLog) << "Could not find" << GpxEngine::timeZonePolygonsFile
+                                  << "- using the timezone map only";
+        } else {
+            timeZoneMap.loadPolygons(polygonsFile);
         }
-        qCDebug(KGeoTagLog) << "Loaded the timezone mapping data from" << timezoneMappingFile;
-    } else {
-        // This should not happen
-        qCDebug(KGeoTagLog) << "Failed to load the timezone mapping data file!";
     }
 
-    // Check if all listed timezones are valid
-
-    if (! m_timezoneMapping.isEmpty()) {
-        const auto allTimeZones = QTimeZone::availableTimeZoneIds();
-        const auto keys = m_timezoneMapping.keys();
+    return timeZoneMap;
+}
 
-        QVector<QByteArray> invalidIds;
+static void setFileIdentity(GpxEngine::ParsedTrack &parsedTrack)
+{
+    // Remember which version of the file we parsed, so that we only cache exactly this one
+    const QFileInfo info(parsedTrack.path);
+    parsedTrack.fileSize = info.size();
+    parsedTrack.lastModified = info.lastModified().toMSecsSinceEpoch();
+}
 
-        for (const auto &key : keys) {
-            const auto timeZoneId = m_timezoneMapping.value(key).toString().toUtf8();
-            if (! allTimeZones.contains(timeZoneId)) {
-                invalidIds.append(timeZoneId);
+GpxEngine::GpxEngine(QObject *parent, GeoDataModel *geoDataModel, bool exactTimeZoneBorders)
+    : QObject(parent),
+      m_geoDataModel(geoDataModel),
+      m_exactTimeZoneBorders(exactTimeZoneBorders)
+{
+    // Load the timezone data in the background, so that it doesn't delay the startup. We only
+    // wait for it if a timezone has to be detected before it's ready.
+    m_timeZoneMapWatcher = new QFutureWatcher<TimeZoneMap>(this);
+    connect(m_timeZoneMapWatcher, &QFutureWatcherBase::finished, this, [this]
+    {
+        const auto &map = timeZoneMap();
+
+        if (m_exactTimeZoneBordersChanged) {
+            // The timezone data has been reloaded with or without the exact borders, so we redo
+            // everything we found using the former data for the already loaded tracks
+            m_exactTimeZoneBordersChanged = false;
+            m_trackTimeZonesPending = false;
+            m_geoDataModel->updateTrackTimeZones(map);
+            if (m_geoDataModel->contains(m_lastDetectedTimeZonePath)) {
+                m_lastDetectedTimeZoneId = detectTimeZone(m_lastDetectedTimeZonePath);
             }
+            Q_EMIT trackTimeZonesChanged();
+
+        } else if (m_trackTimeZonesPending) {
+            // Add the timezones of the cached tracks that have been loaded in the meantime
+            m_trackTimeZonesPending = false;
+            m_geoDataModel->addMissingTrackTimeZones(map);
+            Q_EMIT trackTimeZonesChanged();
         }
 
-        qCDebug(KGeoTagLog) << "Processed" << m_timezoneMapping.count() << "timezone IDs";
+        Q_EMIT timeZoneDataReady(map.isLoaded());
+    });
+    m_timeZoneMapWatcher->setFuture(QtConcurrent::run(&loadTimeZoneMap, exactTimeZoneBorders));
+}
 
-        if (invalidIds.count() > 0) {
-            qCWarning(KGeoTagLog) << "Found" << invalidIds.count() << "unusable timezone ID(s)!";
-            qCWarning(KGeoTagLog) << "    The following IDs are not represented in "
-                                  << "QTimeZone::availableTimeZoneIds():";
-            for (const auto &id : invalidIds) {
-                qCWarning(KGeoTagLog) << "   " << id;
-            }
-        }
+void GpxEngine::setExactTimeZoneBorders(bool state)
+{
+    if (state == m_exactTimeZoneBorders) {
+        return;
+    }
 
-    } else {
-        // This should not happen
-        qCWarning(KGeoTagLog) << "Could not load any timezone IDs!";
+    // Reload the timezone data in the background. As soon as it's ready, the timezones of the
+    // already loaded tracks are looked up again.
+    m_exactTimeZoneBorders = state;
+    m_exactTimeZoneBordersChanged = true;
+    m_timeZoneMapPending = true;
+    m_timeZoneMapWatcher->setFuture(QtConcurrent::run(&loadTimeZoneMap, state));
+}
+
+const TimeZoneMap &GpxEngine::timeZoneMap()
+{
+    if (m_timeZoneMapPending) {
+#ifdef DEBUG_MODE
+        QElapsedTimer timer;
+        timer.start();
+#endif
+        // This blocks if the data is still being loaded
+        m_timeZoneMap = m_timeZoneMapWatcher->result();
+        m_timeZoneMapPending = false;
+#ifdef DEBUG_MODE
+        qCDebug(KGeoTagLog) << "Waited" << timer.nsecsElapsed() / 1000000.0
+                            << "ms for the timezone data";
+#endif
     }
+
+    return m_timeZoneMap;
 }
 
-GpxEngine::LoadInfo GpxEngine::load(const QString &path)
+GpxEngine::LoadInfo GpxEngine::load(const QString &path, GpxEngine::Parser parser)
 {
     if (m_geoDataModel->contains(path)) {
         return { LoadResult::AlreadyLoaded };
     }
 
+    return addParsedTrack(trackParser(parser)(path));
+}
+
+GpxEngine::TrackParser GpxEngine::trackParser(GpxEngine::Parser parser) const
+{
+    // If the timezone data is still being loaded, we assume the exact borders will be used if
+    // they are requested and the polygons file is there
+    const bool exactBorders = m_timeZoneMapWatcher->isFinished()
+        ? m_timeZoneMapWatcher->result().hasPolygons()
+        : m_exactTimeZoneBorders && ! timeZonePolygonsFile().isEmpty();
+    return TrackParser(m_timeZoneMapWatcher->future(), exactBorders, parser);
+}
+
+GpxEngine::TrackParser::TrackParser(const QFuture<TimeZoneMap> &timeZoneMap,
+                                    bool exactTimeZoneBorders, GpxEngine::Parser parser)
+    : m_timeZoneMap(timeZoneMap),
+      m_exactTimeZoneBorders(exactTimeZoneBorders),
+      m_parser(parser)
+{
+}
+
+GpxEngine::ParsedTrack GpxEngine::TrackParser::operator()(const QString &path) const
+{
+    auto parsedTrack = m_parser == MappedParser ? parse(path) : parseXml(path);
+    if (parsedTrack.info.result != LoadResult::Okay) {
+        return parsedTrack;
+    }
+
+    // Cached tracks already carry the timezone detected when they were parsed, so they don't wait
+    // for the timezone data. If it's not ready yet, their timezones are added as soon as it is.
+    // This only works if the cached timezone has been detected using the same borders we use now.
+    if (parsedTrack.fromCache && ! parsedTrack.timeZoneId.isEmpty()
+        && parsedTrack.exactTimeZoneBorders == m_exactTimeZoneBorders
+        && ! m_timeZoneMap.isFinished()) {
+
+        return parsedTrack;
+    }
+
+    // This waits for the timezone data if it's still being loaded
+    const auto timeZoneMap = m_timeZoneMap.result();
+
+    // A cached timezone detected using the other borders is detected again by addParsedTrack()
+    if (parsedTrack.fromCache && parsedTrack.exactTimeZoneBorders != timeZoneMap.hasPolygons()) {
+        parsedTrack.timeZoneId.clear();
+    }
+
+    // Lookup the timezone of each part of the track here, so that this is not done on the GUI
+    // thread
+    parsedTrack.timeZones = TrackTimeZones(parsedTrack.trackPoints, timeZoneMap);
+    parsedTrack.hasTimeZones = true;
+
+    return parsedTrack;
+}
+
+GpxEngine::ParsedTrack GpxEngine::parse(const QString &path)
+{
+    // This function (as well as parseXml()) does not touch any member and can thus be run on a
+    // worker thread. The parsed data is passed to the GeoDataModel via addParsedTrack() afterwards.
+
+    ParsedTrack parsedTrack;
+    parsedTrack.path = path;
+
+    // Use the cached data if we already parsed this very file before
+    if (TrackCache::read(path, parsedTrack)) {
+        qCDebug(KGeoTagLog) << "Loaded" << path << "from the track cache";
+        return parsedTrack;
+    }
+
+    setFileIdentity(parsedTrack);
+
+    QFile gpxFile(path);
+
+    if (! gpxFile.open(QIODevice::ReadOnly)) {
+        parsedTrack.info = { LoadResult::OpenFailed };
+        return parsedTrack;
+    }
+
+    // Scan the mapped file directly if possible
+    const auto size = gpxFile.size();
+    const auto *data = size > 0 ? gpxFile.map(0, size) : nullptr;
+    if (data != nullptr) {
+        GpxScanner scanner(reinterpret_cast<const char *>(data), size);
+        if (scanner.scan(parsedTrack)) {
+            return parsedTrack;
+        }
+        qCDebug(KGeoTagLog) << "Could not scan" << path << "directly, falling back to"
+                            << "QXmlStreamReader";
+    }
+
+    gpxFile.close();
+    return parseXml(path);
+}
+
+GpxEngine::ParsedTrack GpxEngine::parseXml(const QString &path)
+{
+    ParsedTrack parsedTrack;
+    parsedTrack.path = path;
+    setFileIdentity(parsedTrack);
+
     QFile gpxFile(path);
 
     if (! gpxFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return { LoadResult::OpenFailed };
+        parsedTrack.info = { LoadResult::OpenFailed };
+        return parsedTrack;
     }
 
     QXmlStreamReader xml(&gpxFile);
@@ -120,13 +278,9 @@ GpxEngine::LoadInfo GpxEngine::load(const QString &path)
     double lon = 0.0;
     double lat = 0.0;
     double alt = 0.0;
-    QDateTime time;
-
-    QVector<QDateTime> segmentTimes;
-    QVector<Coordinates> segmentCoordinates;
+    qint64 time = TrackPoints::noTime;
 
-    QVector<QVector<Coordinates>> allSegments;
-    QVector<QVector<QDateTime>> allSegmentTimes;
+    TrackPoints trackPoints;
 
     bool gpxFound = false;
     bool trackStartFound = false;
@@ -137,7 +291,8 @@ GpxEngine::LoadInfo GpxEngine::load(const QString &path)
 
     while (! xml.atEnd()) {
         if (xml.hasError()) {
-            return { LoadResult::XmlError };
+            parsedTrack.info = { LoadResult::XmlError };
+            return parsedTrack;
         }
 
         const QXmlStreamReader::TokenType token = xml.readNext();
@@ -176,27 +331,20 @@ GpxEngine::LoadInfo GpxEngine::load(const QString &path)
 
             } else if (name == s_time) {
                 xml.readNext();
-                time = QDateTime::fromString(xml.text().toString(), Qt::ISODate);
-
-                // Strip out milliseconds if the GPX provides them to allow seconds-exact matching
-                const auto msec = time.time().msec();
-                if (msec != 0) {
-                    time = time.addMSecs(msec * -1);
+                const auto text = xml.text().toUtf8();
+                if (! IsoTimestamp::parse(text.constData(), text.size(), time)) {
+                    time = TrackPoints::noTime;
                 }
             }
 
         } else if (token == QXmlStreamReader::EndElement) {
             if (name == s_trkpt) {
-                segmentTimes.append(time);
-                segmentCoordinates.append(Coordinates(lon, lat, alt, true));
+                trackPoints.appendPoint(time, lon, lat, alt);
                 alt = 0.0;
-                time = QDateTime();
+                time = TrackPoints::noTime;
 
-            } else if (name == s_trkseg && ! segmentCoordinates.isEmpty()) {
-                allSegmentTimes.append(segmentTimes);
-                allSegments.append(segmentCoordinates);
-                segmentTimes.clear();
-                segmentCoordinates.clear();
+            } else if (name == s_trkseg) {
+                trackPoints.closeSegment();
 
             } else if (name == s_trk) {
                 trackStartFound = false;
@@ -205,197 +353,99 @@ GpxEngine::LoadInfo GpxEngine::load(const QString &path)
     }
 
     if (! gpxFound) {
-        return { LoadResult::NoGpxElement, tracks, segments, points };
+        parsedTrack.info = { LoadResult::NoGpxElement, tracks, segments, points };
+        return parsedTrack;
     }
 
     if (points == 0) {
-        return { LoadResult::NoGeoData, tracks, segments, points };
+        parsedTrack.info = { LoadResult::NoGeoData, tracks, segments, points };
+        return parsedTrack;
     }
 
     // All okay :-)
+    parsedTrack.info = { LoadResult::Okay, tracks, segments, points };
+    trackPoints.finish();
+    parsedTrack.trackPoints = trackPoints;
 
-    // Pass the loaded data to the GeoDataModel
-    m_geoDataModel->addTrack(path, allSegmentTimes, allSegments);
-
-    // Detect the presumable timezone the corresponding photos were taken in
+    return parsedTrack;
+}
 
-    // Get the loaded path's bounding box's center point
-    const auto trackCenter = m_geoDataModel->trackBoxCenter(path);
+GpxEngine::LoadInfo GpxEngine::addParsedTrack(const GpxEngine::ParsedTrack &track)
+{
+    if (track.info.result != LoadResult::Okay) {
+        return track.info;
+    }
 
-    // Scale the coordinates to the image size, relative to the image center
-    int mappedLon = std::round(trackCenter.lon() / 180.0 * (m_timezoneMapWidth / 2.0));
-    int mappedLat = std::round(trackCenter.lat() / 90.0 * (m_timezoneMapHeight / 2.0));
+    // The same file could have been requested more than once
+    if (m_geoDataModel->contains(track.path)) {
+        return { LoadResult::AlreadyLoaded };
+    }
 
-    // Move the mapped coordinates to the left lower edge
-    mappedLon = m_timezoneMapWidth / 2 + mappedLon;
-    mappedLat = m_timezoneMapHeight - (m_timezoneMapHeight / 2 + mappedLat);
+    // Pass the loaded data to the GeoDataModel, along with the timezone of each part of the track
+    // looked up by the TrackParser
+    if (track.hasTimeZones) {
+        m_geoDataModel->addTrack(track.path, track.trackPoints, track.timeZones);
 
-    // Get the respective pixel's color
-    const auto timezoneColor = m_timezoneMap.pixelColor(mappedLon, mappedLat).name();
+    } else if (m_timeZoneMapWatcher->isFinished()) {
+        // The timezone data has been loaded after the track has been parsed, and it's too late to
+        // add the timezones along with the ones of the other cached tracks
+        m_geoDataModel->addTrack(track.path, track.trackPoints,
+                                 TrackTimeZones(track.trackPoints, timeZoneMap()));
 
-    // Lookup the corresponding timezone
-    const auto timezoneId = m_timezoneMapping.value(timezoneColor);
-    if (timezoneId.isString()) {
-        m_lastDetectedTimeZoneId = timezoneId.toString().toUtf8();
     } else {
-        m_lastDetectedTimeZoneId.clear();
+        // They will be added as soon as the timezone data is ready
+        m_geoDataModel->addTrack(track.path, track.trackPoints, TrackTimeZones());
+        m_trackTimeZonesPending = true;
     }
 
-    return { LoadResult::Okay, tracks, segments, points };
-}
+    m_lastDetectedTimeZonePath = track.path;
 
-void GpxEngine::setMatchParameters(int exactMatchTolerance, int maximumInterpolationInterval,
-                                   int maximumInterpolationDistance)
-{
-    m_exactMatchTolerance = exactMatchTolerance;
-    m_maximumInterpolationInterval = maximumInterpolationInterval;
-    m_maximumInterpolationDistance = maximumInterpolationDistance;
-}
+    if (! track.timeZoneId.isEmpty()) {
+        m_lastDetectedTimeZoneId = track.timeZoneId;
+        return track.info;
+    }
 
-Coordinates GpxEngine::findExactCoordinates(const QDateTime &time, int deviation) const
-{
-    if (deviation == 0) {
-        return findExactCoordinates(time);
-    } else {
-        const QDateTime fixedTime = time.addSecs(deviation);
-        return findExactCoordinates(fixedTime);
+    m_lastDetectedTimeZoneId = detectTimeZone(track.path);
+    const auto &map = timeZoneMap();
+
+    // Cache the freshly parsed track in the background, so that the next load is faster. We also
+    // update the cache if it holds a timezone detected using the other borders.
+    if (! track.fromCache || track.exactTimeZoneBorders != map.hasPolygons()) {
+        auto cachedTrack = track;
+        cachedTrack.timeZoneId = m_lastDetectedTimeZoneId;
+        cachedTrack.exactTimeZoneBorders = map.hasPolygons();
+        QtConcurrent::run(&TrackCache::write, cachedTrack);
     }
+
+    return track.info;
 }
 
-Coordinates GpxEngine::findExactCoordinates(const QDateTime &time) const
+QByteArray GpxEngine::detectTimeZone(const QString &path)
 {
-    // Iterate over all loaded files we have
-    for (const auto &trackPoints : m_geoDataModel->trackPoints()) {
-        // Check for an exact match
-        if (trackPoints.contains(time)) {
-            return trackPoints.value(time);
-        }
+    // Detect the presumable timezone the corresponding photos were taken in
 
-        // Check for a match with +/- the maximum tolerable deviation
-        for (int i = 1; i <= m_exactMatchTolerance; i++) {
-            const auto timeBefore = time.addSecs(i * -1);
-            if (trackPoints.contains(timeBefore)) {
-                return trackPoints.value(timeBefore);
-            }
-            const auto timeAfter = time.addSecs(i);
-            if (trackPoints.contains(timeAfter)) {
-                return trackPoints.value(timeAfter);
-            }
-        }
-    }
+    // Get the loaded path's bounding box's center point
+    const auto trackCenter = m_geoDataModel->trackBoxCenter(path);
 
-    // No match found
-    return Coordinates();
+    // Lookup the timezone there
+    return timeZoneMap().zoneId(trackCenter.lon(), trackCenter.lat());
 }
 
-Coordinates GpxEngine::findInterpolatedCoordinates(const QDateTime &time, int deviation) const
+void GpxEngine::setMatchParameters(int exactMatchTolerance, int maximumInterpolationInterval,
+                                   int maximumInterpolationDistance)
 {
-    if (deviation == 0) {
-        return findInterpolatedCoordinates(time);
-    } else {
-        const QDateTime fixedTime = time.addSecs(deviation);
-        return findInterpolatedCoordinates(fixedTime);
-    }
+    m_exactMatchTolerance = exactMatchTolerance;
+    // This only does something if the limits actually changed
+    m_geoDataModel->setInterpolationLimits(maximumInterpolationInterval,
+                                           maximumInterpolationDistance);
 }
 
-Coordinates GpxEngine::findInterpolatedCoordinates(const QDateTime &time) const
+TrackMatcher GpxEngine::matcher() const
 {
-    // Iterate over all loaded files we have
-    for (int i = 0; i < m_geoDataModel->dateTimes().count(); i++) {
-        const auto &dateTimes = m_geoDataModel->dateTimes().at(i);
-        const auto &trackPoints = m_geoDataModel->trackPoints().at(i);
-
-        // This only works if we at least have at least 2 points ;-)
-        if (dateTimes.count() < 2) {
-            continue;
-        }
-
-        // If the image's date is before the first or after the last point we have,
-        // it can't be assigned.
-        if (time < dateTimes.first() || time > dateTimes.last()) {
-            continue;
-        }
-
-        // Check for an exact match (without tolerance)
-        // This also eliminates the case that the time could be the first one.
-        // We thus can be sure the first entry in dateTimes is earlier than the time requested.
-        if (dateTimes.contains(time)) {
-            return trackPoints.value(time);
-        }
-
-        // Search for the first time earlier than the image's
-
-        int start = 0;
-        int end = dateTimes.count() - 1;
-        int index = 0;
-        int lastIndex = -1;
-
-        while (true) {
-            index = start + (end - start) / 2;
-            if (index == lastIndex) {
-                break;
-            }
-
-            if (dateTimes.at(index) > time) {
-                end = index;
-            } else {
-                start = index;
-            }
-
-            lastIndex = index;
-        }
-
-        // If the found point is the last one, we can't interpolate and use it directly
-        const auto &closestBefore = dateTimes.at(index);
-        if (closestBefore == dateTimes.last()) {
-            return trackPoints.value(closestBefore);
-        }
-
-        // Interpolate between the two coordinates
-
-        const auto &closestAfter = dateTimes.at(index + 1);
-
-        // Check for a maximum time interval between the points if requested
-        if (m_maximumInterpolationInterval != -1
-            && closestBefore.secsTo(closestAfter) > m_maximumInterpolationInterval) {
-
-            continue;
-        }
-
-        // Create Marble coordinates from the cache for further calculations
-        const auto &pointBefore = trackPoints[closestBefore];
-        const auto &pointAfter = trackPoints[closestAfter];
-        const auto coordinatesBefore = Marble::GeoDataCoordinates(
-            pointBefore.lon(), pointBefore.lat(), pointBefore.alt(),
-            Marble::GeoDataCoordinates::Degree);
-        const auto coordinatesAfter = Marble::GeoDataCoordinates(
-            pointAfter.lon(), pointAfter.lat(), pointAfter.alt(),
-            Marble::GeoDataCoordinates::Degree);
-
-        // Check for a maximum distance between the points if requested
-
-        if (m_maximumInterpolationDistance != -1
-            && coordinatesBefore.sphericalDistanceTo(coordinatesAfter) * KGeoTag::earthRadius
-            > m_maximumInterpolationDistance) {
-
-            continue;
-        }
-
-        // Calculate an interpolated position between the coordinates
-
-        const int secondsBefore = closestBefore.secsTo(time);
-        const double fraction = double(secondsBefore)
-                                / double(secondsBefore + time.secsTo(closestAfter));
-        const auto interpolated = coordinatesBefore.interpolate(coordinatesAfter, fraction);
-
-        return Coordinates(interpolated.longitude(Marble::GeoDataCoordinates::Degree),
-                        interpolated.latitude(Marble::GeoDataCoordinates::Degree),
-                        interpolated.altitude(),
-                        true);
-    }
-
-    // No match found
-    return Coordinates();
+    // The returned matcher shares the current track data and match parameters, so that it can
+    // be used on other threads, and it's not affected by tracks being added or removed
+    return TrackMatcher(m_geoDataModel->timeIndex(), m_geoDataModel->trackPoints(),
+                        m_geoDataModel->trackGaps(), m_exactMatchTolerance);
 }
 
 QByteArray GpxEngine::lastDetectedTimeZoneId() const
@@ -403,48 +453,18 @@ QByteArray GpxEngine::lastDetectedTimeZoneId() const
     return m_lastDetectedTimeZoneId;
 }
 
-bool GpxEngine::timeZoneDataLoaded() const
-{
-    return ! m_timezoneMap.isNull() && ! m_timezoneMapping.isEmpty();
-}
-
-QPair<Coordinates, QDateTime> GpxEngine::findClosestTrackPoint(QDateTime time,
-                                                               int cameraClockDeviation) const
+QPair<int, int> GpxEngine::findClosestTrackPoint(const QDateTime &time,
+                                                 int cameraClockDeviation) const
 {
-    if (cameraClockDeviation != 0) {
-        time = time.addSecs(cameraClockDeviation);
-    }
-
-    auto coordinates = Coordinates();
-    auto pointTime = QDateTime();
-    auto deviation = -1;
-
-    // Iterate over all loaded files we have
-    for (const auto &trackPoints : m_geoDataModel->trackPoints()) {
-        if (deviation == -1) {
-            // Initialize the deviation with the first point
-            const auto it = trackPoints.constBegin();
-            deviation = std::abs(it.key().secsTo(time));
-            pointTime = it.key();
-            coordinates = it.value();
-        }
-
-        // Check for an exact match
-        if (trackPoints.contains(time)) {
-            return QPair<Coordinates, QDateTime>(trackPoints.value(time), time);
-        }
-
-        // Check for the time deviation of each point
-        QHash<QDateTime, Coordinates>::const_iterator it;
-        for (it = trackPoints.constBegin(); it != trackPoints.constEnd(); it++) {
-            const auto currentDeviaton = std::abs(it.key().secsTo(time));
-            if (currentDeviaton < deviation) {
-                deviation = currentDeviaton;
-                pointTime = it.key();
-                coordinates = it.value();
-            }
-        }
+    // Returns the track index and the index of the point in the track's time order,
+    // or -1 for both if no track has been loaded (or none has any time information)
+
+    const auto &timeIndex = m_geoDataModel->timeIndex();
+    const auto msecs = time.toMSecsSinceEpoch() + qint64(cameraClockDeviation) * 1000;
+    const int index = matcher().closestIndex(msecs, timeIndex.lowerBound(msecs));
+    if (index == -1) {
+        return qMakePair(-1, -1);
     }
 
-    return QPair<Coordinates, QDateTime>(coordinates, pointTime);
+    return qMakePair(timeIndex.track(index), timeIndex.point(index));
 }
@@ -8,14 +8,18 @@
 // Local includes
 #include "KGeoTag.h"
 #include "Coordinates.h"
+#include "TrackPoints.h"
+#include "TrackMatcher.h"
+#include "TimeZoneMap.h"
+#include "TrackTimeZones.h"
 
 // Qt includes
 #include <QObject>
 #include <QVector>
 #include <QHash>
 #include <QDateTime>
-#include <QImage>
-#include <QJsonObject>
+#include <QFutureWatcher>
+#include <QFuture>
 
 // Local classes
 class GeoDataModel;
@@ -42,33 +46,80 @@ public:
         int points = 0;
     };
 
-    explicit GpxEngine(QObject *parent, GeoDataModel *geoDataModel);
-    GpxEngine::LoadInfo load(const QString &path);
-    Coordinates findExactCoordinates(const QDateTime &time, int deviation) const;
-    Coordinates findInterpolatedCoordinates(const QDateTime &time, int deviation) const;
-    QPair<Coordinates, QDateTime> findClosestTrackPoint(QDateTime time,
-                                                        int cameraClockDeviation) const;
+    struct ParsedTrack
+    {
+        QString path;
+        LoadInfo info;
+        TrackPoints trackPoints;
+        QByteArray timeZoneId;
+        bool exactTimeZoneBorders = false;
+        TrackTimeZones timeZones;
+        bool hasTimeZones = false;
+        qint64 fileSize = 0;
+        qint64 lastModified = 0;
+        bool fromCache = false;
+    };
+
+    enum Parser {
+        MappedParser,
+        XmlStreamParser
+    };
+
+    // Parses a file and looks up the timezones along the parsed track. It doesn't touch the
+    // GpxEngine and can thus be run on worker threads (e.g. via QtConcurrent::mapped()).
+    class TrackParser
+    {
+
+    public:
+        using result_type = GpxEngine::ParsedTrack;
+
+        explicit TrackParser(const QFuture<TimeZoneMap> &timeZoneMap, bool exactTimeZoneBorders,
+                             GpxEngine::Parser parser);
+        GpxEngine::ParsedTrack operator()(const QString &path) const;
+
+    private: // Variables
+        QFuture<TimeZoneMap> m_timeZoneMap;
+        bool m_exactTimeZoneBorders;
+        GpxEngine::Parser m_parser;
+
+    };
+
+    static const QString timeZonePolygonsFile;
+
+    explicit GpxEngine(QObject *parent, GeoDataModel *geoDataModel, bool exactTimeZoneBorders);
+    GpxEngine::LoadInfo load(const QString &path, GpxEngine::Parser parser = MappedParser);
+    static GpxEngine::ParsedTrack parse(const QString &path);
+    static GpxEngine::ParsedTrack parseXml(const QString &path);
+    GpxEngine::TrackParser trackParser(GpxEngine::Parser parser = MappedParser) const;
+    GpxEngine::LoadInfo addParsedTrack(const GpxEngine::ParsedTrack &track);
+    TrackMatcher matcher() const;
+    QPair<int, int> findClosestTrackPoint(const QDateTime &time, int cameraClockDeviation) const;
     void setMatchParameters(int exactMatchTolerance, int maximumInterpolationInterval,
                             int maximumInterpolationDistance);
     QByteArray lastDetectedTimeZoneId() const;
-    bool timeZoneDataLoaded() const;
+    void setExactTimeZoneBorders(bool state);
+
+Q_SIGNALS:
+    void timeZoneDataReady(bool loaded);
+    void trackTimeZonesChanged();
 
 private: // Functions
-    Coordinates findExactCoordinates(const QDateTime &time) const;
-    Coordinates findInterpolatedCoordinates(const QDateTime &time) const;
+    const TimeZoneMap &timeZoneMap();
+    QByteArray detectTimeZone(const QString &path);
 
 private: // Variables
     GeoDataModel *m_geoDataModel;
 
-    int m_exactMatchTolerance;
-    int m_maximumInterpolationInterval;
-    int m_maximumInterpolationDistance;
+    int m_exactMatchTolerance = 0;
 
-    QImage m_timezoneMap;
-    double m_timezoneMapWidth = 0.0;
-    double m_timezoneMapHeight = 0.0;
-    QJsonObject m_timezoneMapping;
+    QFutureWatcher<TimeZoneMap> *m_timeZoneMapWatcher;
+    TimeZoneMap m_timeZoneMap;
+    bool m_timeZoneMapPending = true;
+    bool m_trackTimeZonesPending = false;
+    bool m_exactTimeZoneBorders;
+    bool m_exactTimeZoneBordersChanged = false;
     QByteArray m_lastDetectedTimeZoneId;
+    QString m_lastDetectedTimeZonePath;
 
 };
 
@@ -0,0 +1,591 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    The GpxScanner scans a (memory mapped) GPX file byte by byte, without decoding it to UTF-16
+    and without allocating anything for element names, attributes or text nodes we don't need.
+
+    It is no general-purpose XML parser! It only handles what is needed to read the track data
+    the same way GpxEngine::parseXml() does using QXmlStreamReader. Everything it can't handle
+    (other encodings than UTF-8, DTDs, entity references in values we need, elements not being
+    well-formed etc.) makes scan() return false, so that the caller can fall back to
+    QXmlStreamReader, which then also produces the respective error.
+*/
+
+// Local includes
+#include "GpxScanner.h"
+#include "IsoTimestamp.h"
+
+// Qt includes
+#include <QByteArray>
+#include <QPair>
+
+// C++ includes
+#include <cstring>
+
+namespace
+{
+
+enum Element {
+    OtherElement,
+    GpxElement,
+    TrkElement,
+    TrksegElement,
+    TrkptElement,
+    EleElement,
+    TimeElement
+};
+
+}
+
+// Powers of 10 that can be represented exactly by a double
+static constexpr double s_powersOf10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// The biggest integer a double can represent exactly
+static constexpr quint64 s_maximumExactMantissa = quint64(1) << 53;
+
+static inline bool isWhitespace(char character)
+{
+    return character == ' ' || character == '\t' || character == '\n' || character == '\r';
+}
+
+static bool isWhitespaceOnly(const char *data, const char *end)
+{
+    for (; data < end; data++) {
+        if (! isWhitespace(*data)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline bool equals(const char *data, int length, const char *expected, int expectedLength)
+{
+    return length == expectedLength && std::memcmp(data, expected, length) == 0;
+}
+
+static Element classifyElement(const char *name, int length)
+{
+    // QXmlStreamReader::name() returns the local name, so we strip a possible namespace prefix
+    const auto *colon = static_cast<const char *>(std::memchr(name, ':', length));
+    if (colon != nullptr) {
+        length -= colon + 1 - name;
+        name = colon + 1;
+    }
+
+    switch (length) {
+    case 3:
+        if (equals(name, length, "gpx", 3)) {
+            return GpxElement;
+        } else if (equals(name, length, "trk", 3)) {
+            return TrkElement;
+        } else if (equals(name, length, "ele", 3)) {
+            return EleElement;
+        }
+        break;
+    case 4:
+        if (equals(name, length, "time", 4)) {
+            return TimeElement;
+        }
+        break;
+    case 5:
+        if (equals(name, length, "trkpt", 5)) {
+            return TrkptElement;
+        }
+        break;
+    case 6:
+        if (equals(name, length, "trkseg", 6)) {
+            return TrksegElement;
+        }
+        break;
+    }
+
+    return OtherElement;
+}
+
+static double toDouble(const char *data, int length)
+{
+    const char *end = data + length;
+
+    while (data < end && isWhitespace(*data)) {
+        data++;
+    }
+    while (end > data && isWhitespace(*(end - 1))) {
+        end--;
+    }
+
+    // Fast path for plain decimal numbers like "12.3456789": If the digits fit into a double's
+    // mantissa and the number of decimal places is small enough, one division of two exactly
+    // representable values yields the correctly rounded result, just like Qt's own parsing.
+
+    const char *position = data;
+    bool negative = false;
+    if (position < end && (*position == '-' || *position == '+')) {
+        negative = *position == '-';
+        position++;
+    }
+
+    quint64 mantissa = 0;
+    int digits = 0;
+    int decimalPlaces = 0;
+    bool decimalPoint = false;
+    bool fastPath = position < end;
+
+    for (; position < end; position++) {
+        const char character = *position;
+        if (character >= '0' && character <= '9') {
+            mantissa = mantissa * 10 + (character - '0');
+            digits++;
+            if (decimalPoint) {
+                decimalPlaces++;
+            }
+            if (digits > 18 || mantissa > s_maximumExactMantissa) {
+                fastPath = false;
+                break;
+            }
+        } else if (character == '.' && ! decimalPoint) {
+            decimalPoint = true;
+        } else {
+            fastPath = false;
+            break;
+        }
+    }
+
+    if (fastPath && digits > 0 && decimalPlaces <= 22) {
+        const double value = double(mantissa) / s_powersOf10[decimalPlaces];
+        return negative ? -value : value;
+    }
+
+    // Let Qt handle everything else (exponents, too many digits, invalid input etc.)
+    return QByteArray::fromRawData(data, end - data).toDouble();
+}
+
+GpxScanner::GpxScanner(const char *data, qint64 size)
+    : m_position(data),
+      m_end(data + size)
+{
+}
+
+void GpxScanner::skipWhitespace()
+{
+    while (m_position < m_end && isWhitespace(*m_position)) {
+        m_position++;
+    }
+}
+
+bool GpxScanner::skipPast(const char *terminator, int length)
+{
+    while (true) {
+        const auto *candidate = static_cast<const char *>(
+            std::memchr(m_position, terminator[0], m_end - m_position));
+        if (candidate == nullptr || m_end - candidate < length) {
+            return false;
+        }
+
+        if (std::memcmp(candidate, terminator, length) == 0) {
+            m_position = candidate + length;
+            return true;
+        }
+
+        m_position = candidate + 1;
+    }
+}
+
+bool GpxScanner::checkProlog()
+{
+    const auto size = m_end - m_position;
+
+    // We only handle UTF-8 (or ASCII). UTF-16 and UTF-32 documents either start with a byte order
+    // mark or, following the XML specification, with a null byte in the first four bytes.
+    if (size < 4 || std::memchr(m_position, 0, 4) != nullptr
+        || (uchar(m_position[0]) == 0xFE && uchar(m_position[1]) == 0xFF)
+        || (uchar(m_position[0]) == 0xFF && uchar(m_position[1]) == 0xFE)) {
+
+        return false;
+    }
+
+    // Skip an UTF-8 byte order mark
+    if (uchar(m_position[0]) == 0xEF && uchar(m_position[1]) == 0xBB
+        && uchar(m_position[2]) == 0xBF) {
+
+        m_position += 3;
+    }
+
+    // Check a possibly given encoding in the XML declaration
+
+    if (m_end - m_position < 6 || std::memcmp(m_position, "<?xml", 5) != 0
+        || ! isWhitespace(m_position[5])) {
+
+        // No declaration. QXmlStreamReader assumes UTF-8 in this case.
+        return true;
+    }
+
+    const char *declarationStart = m_position;
+    if (! skipPast("?>", 2)) {
+        return false;
+    }
+
+    const QByteArray declaration = QByteArray::fromRawData(declarationStart,
+                                                           m_position - declarationStart);
+    const int encodingIndex = declaration.indexOf("encoding");
+    if (encodingIndex == -1) {
+        return true;
+    }
+
+    int valueStart = encodingIndex + 8;
+    while (valueStart < declaration.size() && declaration.at(valueStart) != '"'
+           && declaration.at(valueStart) != '\'') {
+
+        valueStart++;
+    }
+    const int valueEnd = valueStart < declaration.size()
+        ? declaration.indexOf(declaration.at(valueStart), valueStart + 1) : -1;
+    if (valueEnd == -1) {
+        return false;
+    }
+
+    const auto encoding = declaration.mid(valueStart + 1, valueEnd - valueStart - 1).toLower();
+    return encoding == "utf-8" || encoding == "utf8" || encoding == "us-ascii";
+}
+
+bool GpxScanner::readName(const char *&name, int &length)
+{
+    name = m_position;
+    while (m_position < m_end && ! isWhitespace(*m_position) && *m_position != '>'
+           && *m_position != '/') {
+
+        m_position++;
+    }
+
+    length = m_position - name;
+    return length > 0 && m_position < m_end;
+}
+
+bool GpxScanner::readAttributes(bool &selfClosing, const char *&lon, int &lonLength,
+                                const char *&lat, int &latLength)
+{
+    while (true) {
+        skipWhitespace();
+        if (m_position >= m_end) {
+            return false;
+        }
+
+        if (*m_position == '>') {
+            m_position++;
+            selfClosing = false;
+            return true;
+        }
+
+        if (*m_position == '/') {
+            if (m_end - m_position < 2 || m_position[1] != '>') {
+                return false;
+            }
+            m_position += 2;
+            selfClosing = true;
+            return true;
+        }
+
+        // Attribute name
+
+        const char *name = m_position;
+        while (m_position < m_end && *m_position != '=' && ! isWhitespace(*m_position)
+               && *m_position != '>' && *m_position != '/') {
+
+            m_position++;
+        }
+        const int nameLength = m_position - name;
+
+        skipWhitespace();
+        if (nameLength == 0 || m_position >= m_end || *m_position != '=') {
+            return false;
+        }
+        m_position++;
+        skipWhitespace();
+
+        // Attribute value
+
+        if (m_position >= m_end || (*m_position != '"' && *m_position != '\'')) {
+            return false;
+        }
+        const char quote = *m_position++;
+        const char *value = m_position;
+        const auto *valueEnd = static_cast<const char *>(
+            std::memchr(m_position, quote, m_end - m_position));
+        if (valueEnd == nullptr) {
+            return false;
+        }
+        const int valueLength = valueEnd - value;
+        m_position = valueEnd + 1;
+
+        // A "<" is not allowed inside an attribute value
+        if (std::memchr(value, '<', valueLength) != nullptr) {
+            return false;
+        }
+
+        const bool isLon = equals(name, nameLength, "lon", 3);
+        const bool isLat = ! isLon && equals(name, nameLength, "lat", 3);
+        if (! isLon && ! isLat) {
+            continue;
+        }
+
+        // We don't resolve entity references
+        if (std::memchr(value, '&', valueLength) != nullptr) {
+            return false;
+        }
+
+        if (isLon) {
+            lon = value;
+            lonLength = valueLength;
+        } else {
+            lat = value;
+            latLength = valueLength;
+        }
+    }
+}
+
+bool GpxScanner::readText(const char *&text, int &length)
+{
+    text = m_position;
+    const auto *textEnd = static_cast<const char *>(
+        std::memchr(m_position, '<', m_end - m_position));
+
+    // We only handle plain text directly followed by the element's end tag (no comments, CDATA
+    // sections or child elements) and without entity references
+    if (textEnd == nullptr || m_end - textEnd < 2 || textEnd[1] != '/') {
+        return false;
+    }
+
+    length = textEnd - text;
+    if (std::memchr(text, '&', length) != nullptr) {
+        return false;
+    }
+
+    m_position = textEnd;
+    return true;
+}
+
+bool GpxScanner::scan(GpxEngine::ParsedTrack &parsedTrack)
+{
+    if (! checkProlog()) {
+        return false;
+    }
+
+    double lon = 0.0;
+    double lat = 0.0;
+    double alt = 0.0;
+    qint64 time = TrackPoints::noTime;
+
+    TrackPoints trackPoints;
+
+    bool gpxFound = false;
+    bool trackStartFound = false;
+
+    int tracks = 0;
+    int segments = 0;
+    int points = 0;
+
+    // The currently open elements, so that we can detect documents that are not well-formed
+    QVector<QPair<const char *, int>> openElements;
+    bool rootElementFound = false;
+
+    const auto processEndElement = [&](Element element)
+    {
+        if (element == TrkptElement) {
+            trackPoints.appendPoint(time, lon, lat, alt);
+            alt = 0.0;
+            time = TrackPoints::noTime;
+
+        } else if (element == TrksegElement) {
+            trackPoints.closeSegment();
+
+        } else if (element == TrkElement) {
+            trackStartFound = false;
+        }
+    };
+
+    while (m_position < m_end) {
+        const auto *tagStart = static_cast<const char *>(
+            std::memchr(m_position, '<', m_end - m_position));
+
+        if (tagStart == nullptr) {
+            // Only whitespace may follow the root element
+            if (! openElements.isEmpty() || ! isWhitespaceOnly(m_position, m_end)) {
+                return false;
+            }
+            break;
+        }
+
+        // No text is allowed outside the root element
+        if (openElements.isEmpty() && ! isWhitespaceOnly(m_position, tagStart)) {
+            return false;
+        }
+
+        m_position = tagStart + 1;
+        if (m_position >= m_end) {
+            return false;
+        }
+
+        // Comments, CDATA sections and processing instructions
+
+        if (*m_position == '!') {
+            if (m_end - m_position >= 3 && std::memcmp(m_position, "!--", 3) == 0) {
+                if (! skipPast("-->", 3)) {
+                    return false;
+                }
+                continue;
+            }
+
+            if (! openElements.isEmpty() && m_end - m_position >= 8
+                && std::memcmp(m_position, "![CDATA[", 8) == 0) {
+
+                if (! skipPast("]]>", 3)) {
+                    return false;
+                }
+                continue;
+            }
+
+            // A DTD or something else we can't handle
+            return false;
+        }
+
+        if (*m_position == '?') {
+            if (! skipPast("?>", 2)) {
+                return false;
+            }
+            continue;
+        }
+
+        // End elements
+
+        if (*m_position == '/') {
+            m_position++;
+
+            const char *name;
+            int length;
+            if (! readName(name, length)) {
+                return false;
+            }
+
+            skipWhitespace();
+            if (m_position >= m_end || *m_position != '>') {
+                return false;
+            }
+            m_position++;
+
+            if (openElements.isEmpty()) {
+                return false;
+            }
+            const auto &openElement = openElements.last();
+            if (! equals(name, length, openElement.first, openElement.second)) {
+                return false;
+            }
+            openElements.removeLast();
+
+            processEndElement(classifyElement(name, length));
+            continue;
+        }
+
+        // Start elements
+
+        // There may only be one root element
+        if (openElements.isEmpty() && rootElementFound) {
+            return false;
+        }
+        rootElementFound = true;
+
+        const char *name;
+        int length;
+        if (! readName(name, length)) {
+            return false;
+        }
+
+        bool selfClosing = false;
+        const char *lonValue = nullptr;
+        const char *latValue = nullptr;
+        int lonLength = 0;
+        int latLength = 0;
+        if (! readAttributes(selfClosing, lonValue, lonLength, latValue, latLength)) {
+            return false;
+        }
+
+        if (! selfClosing) {
+            openElements.append(qMakePair(name, length));
+        }
+
+        const auto element = classifyElement(name, length);
+
+        bool process = true;
+
+        if (! gpxFound) {
+            if (element != GpxElement) {
+                process = false;
+            } else {
+                gpxFound = true;
+            }
+        }
+
+        if (process && ! trackStartFound) {
+            if (element != TrkElement) {
+                process = false;
+            } else {
+                trackStartFound = true;
+                tracks++;
+            }
+        }
+
+        if (process) {
+            if (element == TrksegElement) {
+                segments++;
+
+            } else if (element == TrkptElement) {
+                lon = lonValue != nullptr ? toDouble(lonValue, lonLength) : 0.0;
+                lat = latValue != nullptr ? toDouble(latValue, latLength) : 0.0;
+                points++;
+
+            } else if (element == EleElement || element == TimeElement) {
+                const char *text = nullptr;
+                int textLength = 0;
+                if (! selfClosing && ! readText(text, textLength)) {
+                    return false;
+                }
+
+                if (element == EleElement) {
+                    alt = textLength > 0 ? toDouble(text, textLength) : 0.0;
+
+                } else {
+                    if (! IsoTimestamp::parse(text, textLength, time)) {
+                        time = TrackPoints::noTime;
+                    }
+                }
+            }
+        }
+
+        if (selfClosing) {
+            processEndElement(element);
+        }
+    }
+
+    if (! rootElementFound || ! openElements.isEmpty()) {
+        return false;
+    }
+
+    if (! gpxFound) {
+        parsedTrack.info = { GpxEngine::NoGpxElement, tracks, segments, points };
+        return true;
+    }
+
+    if (points == 0) {
+        parsedTrack.info = { GpxEngine::NoGeoData, tracks, segments, points };
+        return true;
+    }
+
+    parsedTrack.info = { GpxEngine::Okay, tracks, segments, points };
+    trackPoints.finish();
+    parsedTrack.trackPoints = trackPoints;
+
+    return true;
+}
@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef GPXSCANNER_H
+#define GPXSCANNER_H
+
+// Local includes
+#include "GpxEngine.h"
+
+// Qt includes
+#include <QVector>
+
+class GpxScanner
+{
+
+public:
+    explicit GpxScanner(const char *data, qint64 size);
+    bool scan(GpxEngine::ParsedTrack &parsedTrack);
+
+private: // Functions
+    bool checkProlog();
+    bool skipPast(const char *terminator, int length);
+    bool readName(const char *&name, int &length);
+    bool readAttributes(bool &selfClosing, const char *&lon, int &lonLength,
+                        const char *&lat, int &latLength);
+    bool readText(const char *&text, int &length);
+    void skipWhitespace();
+
+private: // Variables
+    const char *m_position;
+    const char *m_end;
+
+};
+
+#endif // GPXSCANNER_H
@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    Helpers for reading the images as fast as possible when they are loaded: Each file is read only
+    once, and the image is never decoded bigger than needed, either by using a preview embedded in
+    the metadata or by letting the decoder scale it down while decoding.
+*/
+
+// Local includes
+#include "ImageDecoding.h"
+
+// KDE includes
+#include <KExiv2/KExiv2Previews>
+
+// Qt includes
+#include <QFile>
+#include <QIODevice>
+#include <QImageReader>
+#include <QSize>
+
+// C++ includes
+#include <cmath>
+#include <limits>
+
+namespace ImageDecoding
+{
+
+QByteArray readFile(QFile &file)
+{
+    // Returns the whole content of the (opened) file, mapped to memory if possible, so that it
+    // can be used for both reading the metadata and decoding the image. The returned data is only
+    // valid as long as the file is open. Files a QByteArray can't hold (2 GiB or more) yield a null
+    // QByteArray.
+
+    const auto size = file.size();
+    if (size > std::numeric_limits<int>::max()) {
+        return QByteArray();
+    }
+
+    if (size > 0) {
+        const auto *data = file.map(0, size);
+        if (data != nullptr) {
+            return QByteArray::fromRawData(reinterpret_cast<const char *>(data), int(size));
+        }
+    }
+
+    // Mapping is not possible for all files (e.g. on some network filesystems)
+    return file.readAll();
+}
+
+QImage embeddedPreview(KExiv2Iface::KExiv2Previews &previews, const QSize &size)
+{
+    // Returns the smallest preview embedded in the image's metadata that is big enough to be
+    // scaled down to the requested size, or a null QImage if there's none. This saves decoding
+    // the full image (most cameras embed a preview with about the display's resolution).
+
+    if (previews.isEmpty()) {
+        return QImage();
+    }
+
+    const auto originalSize = previews.originalSize();
+    if (originalSize.isEmpty()) {
+        return QImage();
+    }
+
+    const auto neededSize = originalSize.scaled(size, Qt::KeepAspectRatio).boundedTo(originalSize);
+    const double originalRatio = double(originalSize.width()) / originalSize.height();
+
+    // The previews are sorted from the largest to the smallest one
+    for (int i = previews.count() - 1; i >= 0; i--) {
+        const int width = previews.width(i);
+        const int height = previews.height(i);
+        if (width < neededSize.width() || height < neededSize.height()) {
+            continue;
+        }
+
+        // Some cameras add black borders to fit the previews to a fixed aspect ratio
+        if (std::abs(double(width) / height - originalRatio) > 0.01 * originalRatio) {
+            continue;
+        }
+
+        const auto image = previews.image(i);
+        if (! image.isNull()) {
+            return image;
+        }
+    }
+
+    return QImage();
+}
+
+QImage decodeScaled(QIODevice *device, const QSize &size)
+{
+    // Decodes the image just big enough to be scaled down to the requested size. For JPEG
+    // files, this lets libjpeg do the downscaling while decoding (by 1/2, 1/4 or 1/8), so that the
+    // full-size image is never created.
+
+    QImageReader reader(device);
+    // The orientation is fixed later using the Exif data
+    reader.setAutoTransform(false);
+
+    const auto originalSize = reader.size();
+    if (originalSize.isValid()) {
+        const auto scaledSize = originalSize.scaled(size, Qt::KeepAspectRatio);
+        if (scaledSize.width() < originalSize.width()) {
+            reader.setScaledSize(scaledSize);
+        }
+    }
+
+    return reader.read();
+}
+
+}
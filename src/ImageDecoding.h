@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef IMAGEDECODING_H
+#define IMAGEDECODING_H
+
+// Qt includes
+#include <QByteArray>
+#include <QImage>
+
+// KDE classes
+namespace KExiv2Iface
+{
+class KExiv2Previews;
+}
+
+// Qt classes
+class QFile;
+class QIODevice;
+class QSize;
+
+namespace ImageDecoding
+{
+
+QByteArray readFile(QFile &file);
+QImage embeddedPreview(KExiv2Iface::KExiv2Previews &previews, const QSize &size);
+QImage decodeScaled(QIODevice *device, const QSize &size);
+
+}
+
+#endif // IMAGEDECODING_H
@@ -6,17 +6,23 @@
 #include "ImagesModel.h"
 #include "KGeoTag.h"
 #include "Coordinates.h"
+#include "ThumbnailCache.h"
+#include "ImageDecoding.h"
 
 // KDE includes
 #include <KLocalizedString>
 #include <KExiv2/KExiv2>
+#include <KExiv2/KExiv2Previews>
 
 // Qt includes
 #include <QFileInfo>
 #include <QFont>
+#include <QFile>
+#include <QBuffer>
 
 // C++ includes
 #include <utility>
+#include <algorithm>
 
 ImagesModel::ImagesModel(QObject *parent, bool splitImagesList, int thumbnailSize, int previewSize)
     : QAbstractListModel(parent),
@@ -115,82 +121,198 @@ QVariant ImagesModel::data(const QModelIndex &index, int role) const
 ImagesModel::LoadResult ImagesModel::addImage(const QString &path)
 {
     // Check if we already have the image
-    if (m_paths.contains(path)) {
+    if (m_imageData.contains(path)) {
         return LoadResult::AlreadyLoaded;
     }
 
-    // Read the image
-    QImage image = QImage(path);
-    if (image.isNull()) {
-        return LoadResult::LoadingImageFailed;
+    return addLoadedImage(loadImage(path));
+}
+
+ImagesModel::LoadedImage ImagesModel::loadImage(const QString &path) const
+{
+    // This function only reads the (never changing) thumbnail and preview sizes, so that it can be
+    // run on a worker thread. The result is passed to addLoadedImage() afterwards.
+
+    LoadedImage loadedImage;
+    loadedImage.path = path;
+
+    // Check if we have cached the thumbnail and the preview from a former session
+    const QFileInfo info(path);
+    const auto lastModified = info.lastModified();
+    const auto uri = ThumbnailCache::uri(path);
+    QImage thumbnail = ThumbnailCache::readThumbnail(uri, lastModified, m_thumbnailSize.width());
+    QImage preview;
+    if (! thumbnail.isNull()) {
+        preview = ThumbnailCache::readPreview(uri, lastModified, m_previewSize.width());
     }
 
-    // Read the exif data
     auto exif = KExiv2Iface::KExiv2();
     exif.setUseXMPSidecar4Reading(true);
-    if (! exif.load(path)) {
-        return LoadResult::LoadingMetadataFailed;
-    }
 
-    // Prepare the images's data struct
-    ImageData data;
+    if (! preview.isNull()) {
+        // We only have to read the exif data
+        if (! exif.load(path)) {
+            loadedImage.result = LoadResult::LoadingMetadataFailed;
+            return loadedImage;
+        }
 
-    // Add the filename
-    const QFileInfo info(path);
-    data.fileName = info.fileName();
+    } else {
+        // Read the file only once and use the data both for decoding the image and for reading
+        // the metadata, so that each image is only opened one time (which is expensive on network
+        // storage)
+        QFile file(path);
+        if (! file.open(QIODevice::ReadOnly)) {
+            loadedImage.result = LoadResult::LoadingImageFailed;
+            return loadedImage;
+        }
+        const auto data = ImageDecoding::readFile(file);
+
+        // Read the image, using an embedded preview if possible. The thumbnail is created with the
+        // size of the shared thumbnail cache, so that other programs can use it as well.
+        const int thumbnailCacheSize = std::max(
+            ThumbnailCache::thumbnailSize(m_thumbnailSize.width()), m_thumbnailSize.width());
+        const auto thumbnailCacheBox = QSize(thumbnailCacheSize, thumbnailCacheSize);
+        const auto neededSize = thumbnailCacheBox.expandedTo(m_previewSize);
+
+        // Files too big for the shared buffer are read via the file and their path instead
+        const bool buffered = ! data.isNull();
+
+        QImage image;
+        if (buffered) {
+            KExiv2Iface::KExiv2Previews previews(data);
+            image = ImageDecoding::embeddedPreview(previews, neededSize);
+        } else {
+            KExiv2Iface::KExiv2Previews previews(path);
+            image = ImageDecoding::embeddedPreview(previews, neededSize);
+        }
+
+        if (image.isNull()) {
+            QIODevice *device = &file;
+            QBuffer buffer;
+            if (buffered) {
+                buffer.setData(data);
+                buffer.open(QIODevice::ReadOnly);
+                device = &buffer;
+            }
+            image = ImageDecoding::decodeScaled(device, neededSize);
+            if (image.isNull()) {
+                loadedImage.result = LoadResult::LoadingImageFailed;
+                return loadedImage;
+            }
+        }
+
+        // Read the exif data. The sidecar file is only merged in when loading from a path, so we
+        // only read the image file again if there's one (or if we have no buffer).
+        if (! (buffered && ! KExiv2Iface::KExiv2::hasSidecar(path) ? exif.loadFromData(data)
+                                                                    : exif.load(path))) {
+            loadedImage.result = LoadResult::LoadingMetadataFailed;
+            return loadedImage;
+        }
+
+        // Fix the image's orientation
+        exif.rotateExifQImage(image, exif.getImageOrientation());
+
+        // Scale the image down for the caches (but never up)
+        const auto scaledDown = [&image](const QSize &size)
+        {
+            return image.width() > size.width() || image.height() > size.height()
+                ? image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation)
+                : image;
+        };
+
+        thumbnail = scaledDown(thumbnailCacheBox);
+        preview = scaledDown(m_previewSize);
+        ThumbnailCache::writeThumbnail(uri, lastModified, thumbnail, m_thumbnailSize.width());
+        ThumbnailCache::writePreview(uri, lastModified, preview, m_previewSize.width());
+    }
+
+    // Add the filename and the modification time (to keep the cache valid after saving)
+    loadedImage.fileName = info.fileName();
+    loadedImage.lastModified = lastModified;
 
     // Read the date
-    data.date = exif.getImageDateTime();
+    auto &date = loadedImage.date;
+    date = exif.getImageDateTime();
+
+    // Add the fraction of a second, if the camera saved one (e.g. for burst shots). The value
+    // holds the fraction's digits, so that "5" means 500 ms and "05" means 50 ms.
+    if (date.isValid() && date.time().msec() == 0) {
+        const auto subSeconds = exif.getExifTagString("Exif.Photo.SubSecTimeOriginal").trimmed();
+        if (! subSeconds.isEmpty()) {
+            bool okay;
+            const int msecs = subSeconds.left(3).leftJustified(3, QLatin1Char('0')).toInt(&okay);
+            if (okay && msecs > 0) {
+                date = date.addMSecs(msecs);
+            }
+        }
+    }
 
     // If no date could be read from the metadata, fall back to file properties
-    if (! data.date.isValid()) {
+    if (! date.isValid()) {
         // First try to get the file's initial creation date
-        data.date = info.birthTime();
+        date = info.birthTime();
 
         // If that fails, fall back to the file's mtime
-        if (! data.date.isValid()) {
-            data.date = info.lastModified();
+        if (! date.isValid()) {
+            date = lastModified;
         }
     }
 
-    // Apply the currently set timezone
-    data.date.setTimeZone(m_timeZone);
-
-    // Strip out milliseconds if the image provides them to allow seconds-exact matching
-    const auto msec = data.date.time().msec();
-    if (msec != 0) {
-        data.date = data.date.addMSecs(msec * -1);
-    }
-
     // Try to read gps information
     double altitude;
     double latitude;
     double longitude;
     if (exif.getGPSInfo(altitude, latitude, longitude)) {
-        data.originalCoordinates = Coordinates(longitude, latitude, altitude, true);
-        data.lastSavedCoordinates = data.originalCoordinates;
-        data.coordinates = data.originalCoordinates;
+        loadedImage.coordinates = Coordinates(longitude, latitude, altitude, true);
     }
 
-    // Fix the image's orientation
-    exif.rotateExifQImage(image, exif.getImageOrientation());
-
     // Create a smaller thumbnail
-    data.thumbnail = QPixmap::fromImage(image.scaled(m_thumbnailSize, Qt::KeepAspectRatio,
-                                                     Qt::SmoothTransformation));
+    loadedImage.thumbnail = thumbnail.scaled(m_thumbnailSize, Qt::KeepAspectRatio,
+                                             Qt::SmoothTransformation);
 
     // Create a bigger preview (to be scaled according to the view size)
-    data.preview = image.scaled(m_previewSize, Qt::KeepAspectRatio);
+    loadedImage.preview = preview.scaled(m_previewSize, Qt::KeepAspectRatio);
 
-    // Find the correct row for the new image (sorted by date)
-    int row = 0;
-    for (const QString &path : m_paths) {
-        if (m_imageData.value(path).date > data.date) {
-            break;
-        }
-        row++;
+    return loadedImage;
+}
+
+ImagesModel::LoadResult ImagesModel::addLoadedImage(const LoadedImage &loadedImage)
+{
+    if (loadedImage.result != LoadResult::LoadingSucceeded) {
+        return loadedImage.result;
+    }
+
+    // The same file could have been requested more than once
+    const auto &path = loadedImage.path;
+    if (m_imageData.contains(path)) {
+        return LoadResult::AlreadyLoaded;
     }
 
+    // Prepare the images's data struct
+    ImageData data;
+    data.fileName = loadedImage.fileName;
+    data.date = loadedImage.date;
+    data.lastModified = loadedImage.lastModified;
+    data.originalCoordinates = loadedImage.coordinates;
+    data.lastSavedCoordinates = loadedImage.coordinates;
+    data.coordinates = loadedImage.coordinates;
+    data.preview = loadedImage.preview;
+
+    // Pixmaps can only be created on the GUI thread
+    data.thumbnail = QPixmap::fromImage(loadedImage.thumbnail);
+
+    // Apply the currently set timezone
+    applyTimeZone(data.date);
+
+    // Find the correct row for the new image (sorted by date). m_paths is always sorted, so that
+    // we can do a binary search, which matters when thousands of images are added.
+    const auto it = std::upper_bound(m_paths.constBegin(), m_paths.constEnd(), data.date,
+        [this](const QDateTime &date, const QString &path)
+        {
+            return date < m_imageData.constFind(path)->date;
+        });
+    const int row = it - m_paths.constBegin();
+
     // Add the image
 
     beginInsertRows(QModelIndex(), row, row);
@@ -266,6 +388,11 @@ Coordinates ImagesModel::coordinates(const QString &path) const
     return m_imageData.value(path).coordinates;
 }
 
+Coordinates ImagesModel::originalCoordinates(const QString &path) const
+{
+    return m_imageData.value(path).originalCoordinates;
+}
+
 void ImagesModel::setCoordinates(const QString &path, const Coordinates &coordinates,
                                  KGeoTag::MatchType matchType)
 {
@@ -276,6 +403,25 @@ void ImagesModel::setCoordinates(const QString &path, const Coordinates &coordin
     emitDataChanged(path);
 }
 
+void ImagesModel::setCoordinates(const QVector<QString> &paths,
+                                 const QVector<Coordinates> &coordinates,
+                                 KGeoTag::MatchType matchType)
+{
+    if (paths.isEmpty()) {
+        return;
+    }
+
+    for (int i = 0; i < paths.count(); i++) {
+        auto &data = m_imageData[paths.at(i)];
+        data.matchType = matchType;
+        data.coordinates = coordinates.at(i);
+        data.changed = true;
+    }
+
+    // Announce all changes at once instead of looking up and updating each row separately
+    Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0), { Qt::DisplayRole });
+}
+
 void ImagesModel::setElevation(const QString &path, double elevation)
 {
     auto &data = m_imageData[path];
@@ -291,6 +437,21 @@ void ImagesModel::resetChanges(const QString &path)
     emitDataChanged(path);
 }
 
+void ImagesModel::resetChanges(const QVector<QString> &paths)
+{
+    if (paths.isEmpty()) {
+        return;
+    }
+
+    for (const auto &path : paths) {
+        auto &data = m_imageData[path];
+        data.coordinates = data.originalCoordinates;
+        data.matchType = KGeoTag::NotMatched;
+    }
+
+    Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0), { Qt::DisplayRole });
+}
+
 QModelIndex ImagesModel::indexFor(const QString &path) const
 {
     return index(m_paths.indexOf(path), 0);
@@ -300,6 +461,13 @@ void ImagesModel::setSaved(const QString &path)
 {
     auto &data = m_imageData[path];
     data.lastSavedCoordinates = data.coordinates;
+
+    // Writing the metadata changed the file's modification time, so we update the cached
+    // thumbnail and preview, which are still valid
+    const auto lastModified = QFileInfo(path).lastModified();
+    ThumbnailCache::updateLastModified(ThumbnailCache::uri(path), data.lastModified,
+                                       lastModified);
+    data.lastModified = lastModified;
 }
 
 KGeoTag::MatchType ImagesModel::matchType(const QString &path) const
@@ -307,13 +475,40 @@ KGeoTag::MatchType ImagesModel::matchType(const QString &path) const
     return m_imageData.value(path).matchType;
 }
 
-void ImagesModel::setImagesTimeZone(const QByteArray &id)
+void ImagesModel::setImagesTimeZone(const QByteArray &id,
+                                    const QVector<TrackTimeZones> &trackTimeZones)
 {
     m_timeZone = QTimeZone(id);
+    m_trackTimeZones = trackTimeZones;
 
     for (const auto &path : m_paths) {
-        m_imageData[path].date.setTimeZone(m_timeZone);
+        applyTimeZone(m_imageData[path].date);
+    }
+}
+
+void ImagesModel::applyTimeZone(QDateTime &date)
+{
+    // If tracks have been passed, we use the timezone of the track portion the image was taken
+    // in. Only if it isn't covered by any track, the globally set timezone is used.
+
+    if (! m_trackTimeZones.isEmpty()) {
+        const auto localTime = QDateTime(date.date(), date.time(), Qt::UTC).toMSecsSinceEpoch();
+        for (const auto &trackTimeZones : std::as_const(m_trackTimeZones)) {
+            const auto id = trackTimeZones.zoneIdForLocalTime(localTime);
+            if (id.isEmpty()) {
+                continue;
+            }
+
+            auto timeZone = m_trackTimeZoneCache.constFind(id);
+            if (timeZone == m_trackTimeZoneCache.constEnd()) {
+                timeZone = m_trackTimeZoneCache.insert(id, QTimeZone(id));
+            }
+            date.setTimeZone(timeZone.value());
+            return;
+        }
     }
+
+    date.setTimeZone(m_timeZone);
 }
 
 bool ImagesModel::hasPendingChanges(const QString &path) const
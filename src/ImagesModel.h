@@ -7,6 +7,7 @@
 
 // Local includes
 #include "KGeoTag.h"
+#include "TrackTimeZones.h"
 
 // KDE includes
 #include <KColorScheme>
@@ -30,6 +31,18 @@ public:
         LoadingSucceeded
     };
 
+    struct LoadedImage
+    {
+        QString path;
+        LoadResult result = LoadingSucceeded;
+        QString fileName;
+        QDateTime date;
+        QDateTime lastModified;
+        Coordinates coordinates;
+        QImage thumbnail;
+        QImage preview;
+    };
+
     explicit ImagesModel(QObject *parent, bool splitImagesList, int thumbnailSize, int previewSize);
 
     int rowCount(const QModelIndex & = QModelIndex()) const override;
@@ -39,6 +52,8 @@ public:
     QModelIndex indexFor(const QString &path) const;
     bool contains(const QString &path) const;
     LoadResult addImage(const QString &path);
+    LoadedImage loadImage(const QString &path) const;
+    LoadResult addLoadedImage(const LoadedImage &loadedImage);
     const QVector<QString> &allImages() const;
     QVector<QString> imagesWithPendingChanges() const;
     QVector<QString> processedSavedImages() const;
@@ -47,22 +62,30 @@ public:
     KGeoTag::MatchType matchType(const QString &path) const;
     void setCoordinates(const QString &path, const Coordinates &coordinates,
                         KGeoTag::MatchType matchType);
+    void setCoordinates(const QVector<QString> &paths, const QVector<Coordinates> &coordinates,
+                        KGeoTag::MatchType matchType);
     void setElevation(const QString &path, double elevation);
     Coordinates coordinates(const QString &path) const;
+    Coordinates originalCoordinates(const QString &path) const;
     void resetChanges(const QString &path);
+    void resetChanges(const QVector<QString> &paths);
     void setSaved(const QString &path);
-    void setImagesTimeZone(const QByteArray &id);
+    void setImagesTimeZone(const QByteArray &id,
+                           const QVector<TrackTimeZones> &trackTimeZones
+                               = QVector<TrackTimeZones>());
     bool hasPendingChanges(const QString &path) const;
     void removeImages(const QVector<QString> &paths);
     void removeAllImages();
 
 private: // Functions
     void emitDataChanged(const QString &path);
+    void applyTimeZone(QDateTime &date);
 
 private: // Variables
     struct ImageData {
         QString fileName;
         QDateTime date;
+        QDateTime lastModified;
         Coordinates originalCoordinates;
         Coordinates lastSavedCoordinates;
         Coordinates coordinates;
@@ -80,6 +103,8 @@ private: // Variables
     QVector<QString> m_paths;
     QHash<QString, ImageData> m_imageData;
     QTimeZone m_timeZone;
+    QVector<TrackTimeZones> m_trackTimeZones;
+    QHash<QByteArray, QTimeZone> m_trackTimeZoneCache;
 
 };
 
@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+// Local includes
+#include "IsoTimestamp.h"
+
+// Qt includes
+#include <QString>
+#include <QDateTime>
+
+namespace IsoTimestamp
+{
+
+static inline bool readDigits(const char *data, int count, int &value)
+{
+    value = 0;
+    for (int i = 0; i < count; i++) {
+        const char character = data[i];
+        if (character < '0' || character > '9') {
+            return false;
+        }
+        value = value * 10 + (character - '0');
+    }
+    return true;
+}
+
+static inline bool isLeapYear(int year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int daysInMonth(int year, int month)
+{
+    static constexpr int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    return month == 2 && isLeapYear(year) ? 29 : days[month - 1];
+}
+
+// Number of days since 1970-01-01 for a date of the proleptic Gregorian calendar
+static qint64 daysSinceEpoch(int year, int month, int day)
+{
+    // Let the year start in March, so that the leap day is the last day of the year
+    if (month <= 2) {
+        year--;
+    }
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const int yearOfEra = year - era * 400;
+    const int dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return qint64(era) * 146097 + dayOfEra - 719468;
+}
+
+bool parseUtc(const char *data, int length, qint64 &msecs)
+{
+    // We only handle the format virtually all GPX files use, i.e. "YYYY-MM-DDTHH:MM:SSZ", with
+    // optionally up to three fractional digits before the "Z" (as written by high-rate loggers).
+
+    if (length < 20 || data[length - 1] != 'Z'
+        || data[4] != '-' || data[7] != '-' || data[10] != 'T'
+        || data[13] != ':' || data[16] != ':') {
+
+        return false;
+    }
+
+    int fraction = 0;
+    if (length > 20) {
+        // Qt rounds fractions with more than three digits, so we leave them to it
+        if (length > 24 || data[19] != '.' || length == 21) {
+            return false;
+        }
+        const int digits = length - 21;
+        if (! readDigits(data + 20, digits, fraction)) {
+            return false;
+        }
+        for (int i = digits; i < 3; i++) {
+            fraction *= 10;
+        }
+    }
+
+    int year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    int second;
+
+    if (! readDigits(data, 4, year) || ! readDigits(data + 5, 2, month)
+        || ! readDigits(data + 8, 2, day) || ! readDigits(data + 11, 2, hour)
+        || ! readDigits(data + 14, 2, minute) || ! readDigits(data + 17, 2, second)) {
+
+        return false;
+    }
+
+    // Leave everything unusual (like year 0, "24:00:00" or leap seconds) to QDateTime
+    if (year < 1 || month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)
+        || hour > 23 || minute > 59 || second > 59) {
+
+        return false;
+    }
+
+    msecs = (daysSinceEpoch(year, month, day) * 86400 + hour * 3600 + minute * 60 + second)
+            * 1000 + fraction;
+    return true;
+}
+
+static bool parseFallback(const char *data, int length, qint64 &msecs)
+{
+    const auto time = QDateTime::fromString(QString::fromUtf8(data, length), Qt::ISODate);
+    if (! time.isValid()) {
+        return false;
+    }
+
+    msecs = time.toMSecsSinceEpoch();
+    return true;
+}
+
+bool parse(const char *data, int length, qint64 &msecs)
+{
+    if (parseUtc(data, length, msecs)) {
+        return true;
+    }
+
+    // Time zone offsets, local times and whatever else Qt can parse
+    return parseFallback(data, length, msecs);
+}
+
+}
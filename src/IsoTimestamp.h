@@ -0,0 +1,19 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef ISOTIMESTAMP_H
+#define ISOTIMESTAMP_H
+
+// Qt includes
+#include <QtGlobal>
+
+namespace IsoTimestamp
+{
+
+bool parseUtc(const char *data, int length, qint64 &msecs);
+bool parse(const char *data, int length, qint64 &msecs);
+
+}
+
+#endif // ISOTIMESTAMP_H
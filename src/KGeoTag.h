@@ -25,6 +25,9 @@ constexpr const double maximalAltitude = 8900.0;
 // Earth radius according to the GRS 80 ellipsoid (radius of a sphere of equal area)
 constexpr const double earthRadius = 6371007.2;
 
+// M_PI is not part of standard C++ (e.g. MSVC only defines it with _USE_MATH_DEFINES)
+constexpr const double pi = 3.14159265358979323846;
+
 // 5 decimal places of degrees result in a precision of at worst about 1 m.
 // This should be by far enough for the present use-case.
 constexpr const int degreesPrecision = 5;
@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    A LiveMatcher keeps the match state of a set of images, so that their matches can be updated
+    each time the camera's clock deviation changes (e.g. while the drift spin boxes are dragged).
+
+    For each image, the position of its (shifted) time in the merged time index is remembered. As
+    long as the time stays between the same two track points, no search is needed at all, and the
+    match is re-evaluated in constant time. Only if it crosses a track point, the new position is
+    searched, starting at the old one. Only images whose match actually changed are reported.
+*/
+
+// Local includes
+#include "LiveMatcher.h"
+#include "Logging.h"
+#include "debugMode.h"
+
+// Qt includes
+#include <QDebug>
+
+#ifdef DEBUG_MODE
+#include <QElapsedTimer>
+#endif
+
+LiveMatcher::LiveMatcher(const TrackMatcher &matcher, const QVector<QString> &paths,
+                         const QVector<qint64> &times,
+                         const QVector<TrackMatcher::Match> &currentMatches)
+    : m_matcher(matcher)
+{
+    m_images.reserve(paths.count());
+    for (int i = 0; i < paths.count(); i++) {
+        Image image;
+        image.path = paths.at(i);
+        image.time = times.at(i);
+        image.match = currentMatches.at(i);
+        m_images.append(image);
+    }
+}
+
+QVector<int> LiveMatcher::update(int cameraClockDeviation)
+{
+#ifdef DEBUG_MODE
+    QElapsedTimer timer;
+    timer.start();
+#endif
+
+    QVector<int> changed;
+
+    for (int i = 0; i < m_images.count(); i++) {
+        auto &image = m_images[i];
+        const auto time = image.time + qint64(cameraClockDeviation) * 1000;
+
+        image.lowerBound = m_matcher.lowerBound(time, image.lowerBound);
+        const auto match = m_matcher.findMatch(time, image.lowerBound);
+
+        if (match.matchType != image.match.matchType
+            || match.coordinates != image.match.coordinates) {
+
+            image.match = match;
+            changed.append(i);
+        }
+    }
+
+#ifdef DEBUG_MODE
+    qCDebug(KGeoTagLog) << "Live matching of" << m_images.count() << "images took"
+                        << timer.nsecsElapsed() / 1000000.0 << "ms," << changed.count()
+                        << "matches changed";
+#endif
+
+    return changed;
+}
+
+const QString &LiveMatcher::path(int image) const
+{
+    return m_images.at(image).path;
+}
+
+const TrackMatcher::Match &LiveMatcher::match(int image) const
+{
+    return m_images.at(image).match;
+}
@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef LIVEMATCHER_H
+#define LIVEMATCHER_H
+
+// Local includes
+#include "TrackMatcher.h"
+
+// Qt includes
+#include <QVector>
+#include <QString>
+
+class LiveMatcher
+{
+
+public:
+    explicit LiveMatcher(const TrackMatcher &matcher, const QVector<QString> &paths,
+                         const QVector<qint64> &times,
+                         const QVector<TrackMatcher::Match> &currentMatches);
+
+    QVector<int> update(int cameraClockDeviation);
+    const QString &path(int image) const;
+    const TrackMatcher::Match &match(int image) const;
+
+private: // Variables
+    struct Image
+    {
+        QString path;
+        qint64 time;
+        int lowerBound = 0;
+        TrackMatcher::Match match;
+    };
+
+    TrackMatcher m_matcher;
+    QVector<Image> m_images;
+
+};
+
+#endif // LIVEMATCHER_H
@@ -26,6 +26,7 @@
 #include "TracksListView.h"
 #include "GeoDataModel.h"
 #include "TrackWalker.h"
+#include "DriftSolver.h"
 #include "Logging.h"
 
 // KDE includes
@@ -47,12 +48,17 @@
 #include <QFileDialog>
 #include <QProgressDialog>
 #include <QFile>
-#include <QTimer>
 #include <QMessageBox>
 #include <QCloseEvent>
 #include <QAbstractButton>
 #include <QVBoxLayout>
 #include <QLoggingCategory>
+#include <QFutureWatcher>
+#include <QEventLoop>
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
+#include <QThread>
+#include <QSet>
 
 // C++ includes
 #include <functional>
@@ -67,6 +73,38 @@ static const QHash<QString, KExiv2Iface::KExiv2::MetadataWritingMode> s_writeMod
       KExiv2Iface::KExiv2::MetadataWritingMode::WRITETOSIDECARANDIMAGE }
 };
 
+// Number of images matched in one go on a worker thread
+static constexpr int s_matchingChunkSize = 1024;
+
+namespace
+{
+
+// Matches a chunk of sorted image dates on a worker thread
+class ChunkMatcher
+{
+
+public:
+    using result_type = QVector<TrackMatcher::Match>;
+
+    explicit ChunkMatcher(const TrackMatcher &matcher, KGeoTag::SearchType searchType)
+        : m_matcher(matcher),
+          m_searchType(searchType)
+    {
+    }
+
+    QVector<TrackMatcher::Match> operator()(const QVector<qint64> &times) const
+    {
+        return m_matcher.findMatches(times, m_searchType);
+    }
+
+private: // Variables
+    TrackMatcher m_matcher;
+    KGeoTag::SearchType m_searchType;
+
+};
+
+}
+
 MainWindow::MainWindow(SharedObjects *sharedObjects)
     : KXmlGuiWindow(),
       m_sharedObjects(sharedObjects),
@@ -194,6 +232,18 @@ MainWindow::MainWindow(SharedObjects *sharedObjects)
     connect(m_automaticMatchingWidget, &AutomaticMatchingWidget::requestReassignment,
             this, &MainWindow::triggerCompleteAutomaticMatching);
 
+    // Flag the track gaps exceeding the interpolation limits right away, and each time they are
+    // changed, so that matching only has to look them up
+    const auto updateInterpolationLimits = [this]
+    {
+        m_geoDataModel->setInterpolationLimits(
+            m_automaticMatchingWidget->maximumInterpolationInterval(),
+            m_automaticMatchingWidget->maximumInterpolationDistance());
+    };
+    updateInterpolationLimits();
+    connect(m_automaticMatchingWidget, &AutomaticMatchingWidget::matchParametersChanged,
+            this, updateInterpolationLimits);
+
     // Fix drift
     m_fixDriftWidget = new FixDriftWidget;
     m_fixDriftDock = createDockWidget(i18n("Fix time drift"), m_fixDriftWidget,
@@ -202,6 +252,26 @@ MainWindow::MainWindow(SharedObjects *sharedObjects)
             this, &MainWindow::imagesTimeZoneChanged);
     connect(m_fixDriftWidget, &FixDriftWidget::cameraDriftSettingsChanged,
             this, &MainWindow::cameraDriftSettingsChanged);
+    connect(m_fixDriftWidget, &FixDriftWidget::liveMatchingToggled,
+            this, &MainWindow::liveMatchingToggled);
+    connect(m_fixDriftWidget, &FixDriftWidget::requestDeviationEstimation,
+            this, &MainWindow::estimateCameraClockDeviation);
+
+    // The live matcher's state is outdated as soon as images or tracks are added or removed
+    const auto resetLiveMatcher = [this]
+    {
+        m_liveMatcher.reset();
+    };
+    connect(m_imagesModel, &QAbstractItemModel::rowsInserted, this, resetLiveMatcher);
+    connect(m_imagesModel, &QAbstractItemModel::rowsRemoved, this, resetLiveMatcher);
+    connect(m_geoDataModel, &QAbstractItemModel::dataChanged, this, resetLiveMatcher);
+    connect(m_geoDataModel, &QAbstractItemModel::rowsRemoved, this, resetLiveMatcher);
+    connect(m_automaticMatchingWidget, &AutomaticMatchingWidget::matchParametersChanged,
+            this, [this]
+            {
+                m_liveMatcher.reset();
+                updateLiveMatching();
+            });
 
     // Map
 
@@ -233,16 +303,17 @@ MainWindow::MainWindow(SharedObjects *sharedObjects)
     connect(m_tracksView, &TracksListView::trackSelected, m_mapWidget, &MapWidget::zoomToTrack);
     connect(m_tracksView, &TracksListView::removeTracks, this, &MainWindow::removeTracks);
 
-    auto *trackWalker = new TrackWalker(m_geoDataModel);
+    m_trackWalker = new TrackWalker(m_geoDataModel);
     connect(m_tracksView, &TracksListView::updateTrackWalker,
-            trackWalker, &TrackWalker::setToTrack);
-    connect(trackWalker, &TrackWalker::trackPointSelected, this, &MainWindow::centerTrackPoint);
+            m_trackWalker, &TrackWalker::setToTrack);
+    connect(m_trackWalker, &TrackWalker::trackPointSelected,
+            this, &MainWindow::centerTrackPoint);
 
     auto *tracksWrapper = new QWidget;
     auto *tracksWrapperLayout = new QVBoxLayout(tracksWrapper);
     tracksWrapperLayout->setContentsMargins(0, 0, 0, 0);
     tracksWrapperLayout->addWidget(m_tracksView);
-    tracksWrapperLayout->addWidget(trackWalker);
+    tracksWrapperLayout->addWidget(m_trackWalker);
 
     m_tracksDock = createDockWidget(i18n("Tracks"), tracksWrapper, QStringLiteral("tracksDock"));
 
@@ -262,12 +333,15 @@ MainWindow::MainWindow(SharedObjects *sharedObjects)
     connect(m_sharedObjects->elevationEngine(), &ElevationEngine::notAllPresent,
             this, &MainWindow::notAllElevationsPresent);
 
-    // Check if we could setup the timezone detection properly
-    QTimer::singleShot(0, [this]
+    // Check if we could setup the timezone detection properly. The data is loaded in the
+    // background, so the main window will already be visible if this warning should be displayed
+    // Cached tracks loaded before the timezone data was ready get their timezones afterwards
+    connect(m_gpxEngine, &GpxEngine::trackTimeZonesChanged,
+            this, &MainWindow::updateTrackTimeZones);
+
+    connect(m_gpxEngine, &GpxEngine::timeZoneDataReady, this, [this](bool loaded)
     {
-        // We do this in a QTimer singleShot so that the main window
-        // will be already visible if this warning should be displayed
-        if (! m_gpxEngine->timeZoneDataLoaded()) {
+        if (! loaded) {
             QMessageBox::warning(this, i18n("Loading timezone data"),
                 i18n("<p>Could not load or parse the timezone data files "
                      "<kbd>timezones.json</kbd> and/or <kbd>timezones.png</kbd>. Automatic "
@@ -584,14 +658,62 @@ void MainWindow::addGpx(const QVector<QString> &paths)
 
     QApplication::setOverrideCursor(Qt::WaitCursor);
 
-    for (const auto &path : paths) {
-        processed++;
+    // Parse all requested files in parallel. Only the final merge into the GeoDataModel is done
+    // here, on the GUI thread.
 
-        const QFileInfo info(path);
+    QVector<QString> parsePaths;
+    QVector<int> parseIndex(filesCount, -1);
+    for (int i = 0; i < filesCount; i++) {
+        const QFileInfo info(paths.at(i));
         m_settings->saveLastOpenPath(info.dir().absolutePath());
 
-        const auto [ result, tracks, segments, points ]
-            = m_gpxEngine->load(info.canonicalFilePath());
+        const auto canonicalPath = info.canonicalFilePath();
+        if (! m_geoDataModel->contains(canonicalPath)) {
+            parseIndex[i] = parsePaths.count();
+            parsePaths.append(canonicalPath);
+        }
+    }
+
+    const int parseCount = parsePaths.count();
+    QProgressDialog progress(i18n("Loading GPX files ..."), i18n("Cancel"), 0, parseCount, this);
+    progress.setWindowModality(Qt::WindowModal);
+
+    QFutureWatcher<GpxEngine::ParsedTrack> watcher;
+    QEventLoop loop;
+
+    connect(&watcher, &QFutureWatcher<GpxEngine::ParsedTrack>::progressValueChanged,
+            &progress, [&progress, parseCount](int value)
+            {
+                progress.setLabelText(i18n("Loading GPX files (%1/%2) ...", value, parseCount));
+                progress.setValue(value);
+            });
+    connect(&progress, &QProgressDialog::canceled,
+            &watcher, &QFutureWatcher<GpxEngine::ParsedTrack>::cancel);
+    connect(&watcher, &QFutureWatcher<GpxEngine::ParsedTrack>::finished, &loop, &QEventLoop::quit);
+
+    watcher.setFuture(QtConcurrent::mapped(parsePaths, m_gpxEngine->trackParser()));
+    if (! watcher.isFinished()) {
+        loop.exec();
+    }
+
+    progress.reset();
+
+    const auto future = watcher.future();
+
+    for (int i = 0; i < filesCount; i++) {
+        const int index = parseIndex.at(i);
+
+        // If the loading process has been canceled, not all files have been parsed
+        if (index != -1 && ! future.isResultReadyAt(index)) {
+            continue;
+        }
+
+        processed++;
+        const auto &path = paths.at(i);
+
+        const auto [ result, tracks, segments, points ] = index == -1
+            ? GpxEngine::LoadInfo { GpxEngine::AlreadyLoaded }
+            : m_gpxEngine->addParsedTrack(future.resultAt(index));
 
         QString errorString;
 
@@ -710,6 +832,23 @@ void MainWindow::addGpx(const QVector<QString> &paths)
         }
     }
 
+    // Tell the user if the tracks cross timezone borders
+    QSet<QByteArray> trackZoneIds;
+    for (const auto &trackTimeZones : m_geoDataModel->trackTimeZones()) {
+        for (const auto &id : trackTimeZones.zoneIds()) {
+            trackZoneIds.insert(id);
+        }
+    }
+    if (allTracks > 0 && trackZoneIds.count() > 1 && m_fixDriftWidget->trackTimeZones()) {
+        text.append(i18np("<p>The loaded tracks cross one timezone. Each image's date is "
+                          "interpreted in the timezone of the track portion recorded at that "
+                          "time.</p>",
+                          "<p>The loaded tracks cross %1 timezones. Each image's date is "
+                          "interpreted in the timezone of the track portion recorded at that "
+                          "time.</p>",
+                          trackZoneIds.count()));
+    }
+
     QApplication::restoreOverrideCursor();
 
     // Display the load result
@@ -718,6 +857,7 @@ void MainWindow::addGpx(const QVector<QString> &paths)
     // Adopt the detected timezone
 
     const QByteArray &id = m_gpxEngine->lastDetectedTimeZoneId();
+    bool timeZoneChanged = false;
 
     if (allTracks > 0 && id != m_fixDriftWidget->imagesTimeZoneId()) {
         if (id.isEmpty()) {
@@ -738,6 +878,7 @@ void MainWindow::addGpx(const QVector<QString> &paths)
                          "drift\" page.</p>",
                          QString::fromLatin1(id)));
             } else {
+                timeZoneChanged = true;
                 QMessageBox::information(this, i18n("Timezone adjusted"),
                     i18n("<p>The loaded GPX file was presumably recorded in the timezone \"%1\", "
                          "as well as the photos to associate with it. This timezone has been "
@@ -748,6 +889,11 @@ void MainWindow::addGpx(const QVector<QString> &paths)
             }
         }
     }
+
+    // Changing the timezone already applied the new tracks' timezones
+    if (allTracks > 0 && ! timeZoneChanged) {
+        updateTrackTimeZones();
+    }
 }
 
 void MainWindow::addImages(const QVector<QString> &paths)
@@ -762,31 +908,115 @@ void MainWindow::addImages(const QVector<QString> &paths)
     int processed = 0;
     int loaded = 0;
     int alreadyLoaded = 0;
-    bool skipImage = false;
     bool abortLoad = false;
 
     QProgressDialog progress(i18n("Loading images ..."), i18n("Cancel"), 0, requested, this);
     progress.setWindowModality(Qt::WindowModal);
 
+    // Load the images on the thread pool. The workers read the metadata and create the thumbnail
+    // and preview images, and only inserting them into the model (which includes creating the
+    // pixmaps) is done here, on the GUI thread, as soon as each one is ready.
+    //
+    // Only a limited number of images is requested at once, and the next one only when a result
+    // has been processed. This way, the workers can't run ahead of the model insertion and pile up
+    // decoded images, and canceling stops the loading process quickly.
+
+    const int maximumPending = std::max(QThread::idealThreadCount(), 1) * 2;
+    QVector<QString> canonicalPaths;
+    canonicalPaths.reserve(requested);
     for (const auto &path : paths) {
-        progress.setValue(processed++);
-        if (progress.wasCanceled()) {
-            break;
+        canonicalPaths.append(QFileInfo(path).canonicalFilePath());
+    }
+
+    QVector<int> failedImages;
+    QVector<ImagesModel::LoadResult> failedResults;
+    int next = 0;
+    int pending = 0;
+    bool canceled = false;
+    QEventLoop loop;
+
+    std::function<void()> requestImages;
+
+    const auto processImage = [&, this](int i, const ImagesModel::LoadedImage &loadedImage)
+    {
+        pending--;
+        progress.setValue(++processed);
+
+        if (! canceled) {
+            const auto result = m_imagesModel->addLoadedImage(loadedImage);
+            if (result == ImagesModel::LoadingSucceeded) {
+                loaded++;
+            } else if (result == ImagesModel::AlreadyLoaded) {
+                alreadyLoaded++;
+                loaded++;
+            } else {
+                failedImages.append(i);
+                failedResults.append(result);
+            }
         }
 
-        const QFileInfo info(path);
+        requestImages();
+        if (pending == 0) {
+            loop.quit();
+        }
+    };
+
+    requestImages = [&, this]
+    {
+        while (! canceled && pending < maximumPending && next < requested) {
+            const int i = next++;
+            const auto &path = canonicalPaths.at(i);
+
+            // Skip images we already have without bothering the workers
+            if (m_imagesModel->contains(path)) {
+                progress.setValue(++processed);
+                alreadyLoaded++;
+                loaded++;
+                continue;
+            }
+
+            pending++;
+            QtConcurrent::run([this, i, path, &processImage]
+            {
+                const auto loadedImage = m_imagesModel->loadImage(path);
+                QMetaObject::invokeMethod(this, [i, loadedImage, &processImage]
+                {
+                    processImage(i, loadedImage);
+                }, Qt::QueuedConnection);
+            });
+        }
+    };
+
+    connect(&progress, &QProgressDialog::canceled, &loop, [&canceled, &pending, &loop]
+    {
+        // Wait for the images still being loaded, but discard them
+        canceled = true;
+        if (pending == 0) {
+            loop.quit();
+        }
+    });
+
+    requestImages();
+    if (pending > 0) {
+        loop.exec();
+    }
+
+    progress.reset();
+
+    // Report the images that failed to load and let the user retry them
+
+    for (int j = 0; j < failedImages.count() && ! abortLoad; j++) {
+        const int i = failedImages.at(j);
+        const auto &path = paths.at(i);
+        auto result = failedResults.at(j);
+        const int position = i + 1;
+
         while (true) {
             QString errorString;
-            bool exitLoop = false;
 
-            switch (m_imagesModel->addImage(info.canonicalFilePath())) {
+            switch (result) {
             case ImagesModel::LoadingSucceeded:
-                exitLoop = true;
-                break;
-
             case ImagesModel::AlreadyLoaded:
-                alreadyLoaded++;
-                exitLoop = true;
                 break;
 
             case ImagesModel::LoadingImageFailed:
@@ -799,7 +1029,7 @@ void MainWindow::addImages(const QVector<QString> &paths)
                         "Message with a fraction of processed files added in round braces",
                         "<p><b>Loading image failed (%1/%2)</b></p>"
                         "<p>Could not read <kbd>%3</kbd>.</p>",
-                        processed, requested, path);
+                        position, requested, path);
                 }
                 break;
 
@@ -814,13 +1044,17 @@ void MainWindow::addImages(const QVector<QString> &paths)
                         "Message with a fraction of processed files added in round braces",
                         "<p><b>Loading image's Exif header or XMP sidecar file failed</b></p>"
                         "<p>Could not read <kbd>%2</kbd>.</p>",
-                        processed, requested, path);
+                        position, requested, path);
                 }
                 break;
 
             }
 
-            if (exitLoop || errorString.isEmpty()) {
+            if (errorString.isEmpty()) {
+                if (result == ImagesModel::AlreadyLoaded) {
+                    alreadyLoaded++;
+                }
+                loaded++;
                 break;
             }
 
@@ -835,31 +1069,22 @@ void MainWindow::addImages(const QVector<QString> &paths)
                                         "loading process.</p>"));
             }
 
-            progress.reset();
             QApplication::restoreOverrideCursor();
 
             RetrySkipAbortDialog dialog(this, i18n("Add images"), errorString, isSingleFile);
             const auto reply = dialog.exec();
             if (reply == RetrySkipAbortDialog::Skip) {
-                skipImage = true;
+                QApplication::setOverrideCursor(Qt::WaitCursor);
                 break;
             } else if (reply == RetrySkipAbortDialog::Abort) {
+                QApplication::setOverrideCursor(Qt::WaitCursor);
                 abortLoad = true;
                 break;
             }
 
             QApplication::setOverrideCursor(Qt::WaitCursor);
+            result = m_imagesModel->addImage(canonicalPaths.at(i));
         }
-
-        if (skipImage) {
-            skipImage = false;
-            continue;
-        }
-        if (abortLoad) {
-            break;
-        }
-
-        loaded++;
     }
 
     progress.reset();
@@ -1050,66 +1275,107 @@ void MainWindow::matchAutomatically(const QVector<QString> &paths, KGeoTag::Sear
 
     QApplication::setOverrideCursor(Qt::WaitCursor);
 
+    // The matches found here replace the ones the live matcher knows about
+    m_liveMatcher.reset();
+
     m_gpxEngine->setMatchParameters(m_automaticMatchingWidget->exactMatchTolerance(),
                                     m_automaticMatchingWidget->maximumInterpolationInterval(),
                                     m_automaticMatchingWidget->maximumInterpolationDistance());
 
-    int exactMatches = 0;
-    int interpolatedMatches = 0;
-    QString lastMatchedPath;
+    // The images' dates (with the camera's clock deviation applied) have to be sorted, so that
+    // they can be matched in one pass
 
-    QProgressDialog progress(i18n("Assigning images ..."), i18n("Cancel"), 0, paths.count(), this);
-    progress.setWindowModality(Qt::WindowModal);
+    const qint64 deviation = qint64(m_fixDriftWidget->cameraClockDeviation()) * 1000;
 
-    int processed = 0;
-    int notMatched = 0;
-    int notMatchedButHaveCoordinates = 0;
-
-    for (const auto &path : paths) {
-        progress.setValue(processed++);
-        if (progress.wasCanceled()) {
-            break;
-        }
-
-        Coordinates coordinates;
-
-        // Search for exact matches if requested
+    QVector<QPair<qint64, int>> sortedTimes;
+    sortedTimes.reserve(paths.count());
+    for (int i = 0; i < paths.count(); i++) {
+        sortedTimes.append(qMakePair(
+            m_imagesModel->date(paths.at(i)).toMSecsSinceEpoch() + deviation, i));
+    }
+    std::sort(sortedTimes.begin(), sortedTimes.end());
 
-        if (searchType == KGeoTag::CombinedMatchSearch
-            || searchType == KGeoTag::ExactMatchSearch) {
+    // Split them into chunks that are matched in parallel
 
-            coordinates = m_gpxEngine->findExactCoordinates(
-                m_imagesModel->date(path), m_fixDriftWidget->cameraClockDeviation());
+    QVector<QVector<qint64>> chunks;
+    for (int i = 0; i < sortedTimes.count(); i += s_matchingChunkSize) {
+        const int end = std::min(i + s_matchingChunkSize, sortedTimes.count());
+        QVector<qint64> chunk;
+        chunk.reserve(end - i);
+        for (int j = i; j < end; j++) {
+            chunk.append(sortedTimes.at(j).first);
         }
+        chunks.append(chunk);
+    }
 
-        if (coordinates.isSet()) {
-            m_imagesModel->setCoordinates(path, coordinates, KGeoTag::ExactMatch);
-            exactMatches++;
-            lastMatchedPath = path;
-            continue;
-        }
+    int exactMatches = 0;
+    int interpolatedMatches = 0;
+    int lastMatchedIndex = -1;
+    int notMatched = 0;
+    int notMatchedButHaveCoordinates = 0;
 
-        // Search for interpolated matches if requested
+    QProgressDialog progress(i18n("Assigning images ..."), i18n("Cancel"), 0, chunks.count(),
+                             this);
+    progress.setWindowModality(Qt::WindowModal);
 
-        if (searchType == KGeoTag::CombinedMatchSearch
-            || searchType == KGeoTag::InterpolatedMatchSearch) {
+    QFutureWatcher<QVector<TrackMatcher::Match>> watcher;
+    QEventLoop loop;
+    connect(&watcher, &QFutureWatcherBase::progressValueChanged,
+            &progress, &QProgressDialog::setValue);
+    connect(&watcher, &QFutureWatcherBase::finished, &loop, &QEventLoop::quit);
+    connect(&progress, &QProgressDialog::canceled, &watcher, &QFutureWatcherBase::cancel);
 
-            coordinates = m_gpxEngine->findInterpolatedCoordinates(
-                m_imagesModel->date(path), m_fixDriftWidget->cameraClockDeviation());
-        }
+    // Assign each chunk's coordinates as soon as it has been matched, so that the images model
+    // only announces one change per chunk
+    connect(&watcher, &QFutureWatcherBase::resultReadyAt, this, [&](int chunk)
+    {
+        const auto matches = watcher.resultAt(chunk);
+        const int offset = chunk * s_matchingChunkSize;
+
+        QVector<QString> exactPaths;
+        QVector<Coordinates> exactCoordinates;
+        QVector<QString> interpolatedPaths;
+        QVector<Coordinates> interpolatedCoordinates;
+
+        for (int i = 0; i < matches.count(); i++) {
+            const auto &match = matches.at(i);
+            const int index = sortedTimes.at(offset + i).second;
+            const auto &path = paths.at(index);
+
+            if (match.matchType == KGeoTag::ExactMatch) {
+                exactPaths.append(path);
+                exactCoordinates.append(match.coordinates);
+                exactMatches++;
+                lastMatchedIndex = std::max(lastMatchedIndex, index);
+
+            } else if (match.matchType == KGeoTag::InterpolatedMatch) {
+                interpolatedPaths.append(path);
+                interpolatedCoordinates.append(match.coordinates);
+                interpolatedMatches++;
+                lastMatchedIndex = std::max(lastMatchedIndex, index);
 
-        if (coordinates.isSet()) {
-            m_imagesModel->setCoordinates(path, coordinates, KGeoTag::InterpolatedMatch);
-            interpolatedMatches++;
-            lastMatchedPath = path;
-        } else {
-            notMatched++;
-            if (m_imagesModel->coordinates(path).isSet()) {
-                notMatchedButHaveCoordinates++;
+            } else {
+                notMatched++;
+                if (m_imagesModel->coordinates(path).isSet()) {
+                    notMatchedButHaveCoordinates++;
+                }
             }
         }
+
+        m_imagesModel->setCoordinates(exactPaths, exactCoordinates, KGeoTag::ExactMatch);
+        m_imagesModel->setCoordinates(interpolatedPaths, interpolatedCoordinates,
+                                      KGeoTag::InterpolatedMatch);
+    });
+
+    watcher.setFuture(QtConcurrent::mapped(chunks,
+                                           ChunkMatcher(m_gpxEngine->matcher(), searchType)));
+    if (! watcher.isFinished()) {
+        loop.exec();
     }
 
+    const QString lastMatchedPath = lastMatchedIndex != -1 ? paths.at(lastMatchedIndex)
+                                                           : QString();
+
     progress.reset();
 
     QString title;
@@ -1473,6 +1739,7 @@ void MainWindow::showSettings()
     }
 
     m_mapWidget->updateSettings();
+    m_gpxEngine->setExactTimeZoneBorders(m_settings->exactTimeZoneBorders());
 }
 
 void MainWindow::removeCoordinates(ImagesListView *list)
@@ -1576,8 +1843,16 @@ void MainWindow::elevationProcessed(ElevationEngine::Target target, const QVecto
 void MainWindow::imagesTimeZoneChanged()
 {
     QApplication::setOverrideCursor(Qt::WaitCursor);
-    m_imagesModel->setImagesTimeZone(m_fixDriftWidget->imagesTimeZoneId());
+    m_imagesModel->setImagesTimeZone(m_fixDriftWidget->imagesTimeZoneId(),
+                                     m_fixDriftWidget->trackTimeZones()
+                                         ? m_geoDataModel->trackTimeZones()
+                                         : QVector<TrackTimeZones>());
     m_previewWidget->reload();
+
+    // All images' dates changed, so the live matcher has to start over
+    m_liveMatcher.reset();
+    updateLiveMatching();
+
     QApplication::restoreOverrideCursor();
 }
 
@@ -1585,6 +1860,169 @@ void MainWindow::cameraDriftSettingsChanged()
 {
     m_previewWidget->setCameraClockDeviation(
         m_fixDriftWidget->displayFixed() ? m_fixDriftWidget->cameraClockDeviation() : 0);
+    updateLiveMatching();
+}
+
+void MainWindow::liveMatchingToggled(bool state)
+{
+    m_liveMatcher.reset();
+    if (state) {
+        updateLiveMatching();
+    }
+}
+
+void MainWindow::estimateCameraClockDeviation()
+{
+    const QString title = i18n("Estimate camera clock deviation");
+
+    if (m_geoDataModel->rowCount() == 0) {
+        QMessageBox::information(this, title,
+                                 i18n("Can't estimate the deviation:\n"
+                                      "No GPS tracks have been loaded yet."));
+        return;
+    }
+
+    // Use all images that already had coordinates when they were loaded, and all that have been
+    // placed manually
+
+    QVector<qint64> times;
+    QVector<Coordinates> coordinates;
+    for (const auto &path : m_imagesModel->allImages()) {
+        Coordinates position;
+        if (m_imagesModel->matchType(path) == KGeoTag::ManuallySet) {
+            position = m_imagesModel->coordinates(path);
+        } else {
+            position = m_imagesModel->originalCoordinates(path);
+        }
+
+        if (position.isSet()) {
+            times.append(m_imagesModel->date(path).toMSecsSinceEpoch());
+            coordinates.append(position);
+        }
+    }
+
+    if (times.isEmpty()) {
+        QMessageBox::information(this, title,
+            i18n("Can't estimate the deviation:\n"
+                 "There are no images that already had coordinates when they were loaded or that "
+                 "have been placed manually."));
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+
+    m_gpxEngine->setMatchParameters(m_automaticMatchingWidget->exactMatchTolerance(),
+                                    m_automaticMatchingWidget->maximumInterpolationInterval(),
+                                    m_automaticMatchingWidget->maximumInterpolationDistance());
+
+    const DriftSolver solver(m_gpxEngine->matcher(), m_geoDataModel->trackPoints());
+    const auto result = solver.solve(times, coordinates, 86400);
+
+    QApplication::restoreOverrideCursor();
+
+    if (! result.found) {
+        QMessageBox::warning(this, title,
+            i18np("Could not find a deviation that matches the tagged image to the loaded tracks.",
+                  "Could not find a deviation that matches any of the %1 tagged images to the "
+                  "loaded tracks.",
+                  times.count()));
+        return;
+    }
+
+    m_fixDriftWidget->setCameraClockDeviation(result.deviation);
+
+    QMessageBox::information(this, title,
+        i18ncp("Message for the estimated deviation. The number of images used for it (%2) and "
+               "the median distance (%3) are provided by the following i18np calls.",
+               "<p>The camera clock deviation has been set to one second.</p><p>It matches %2 "
+               "to the loaded tracks with a median distance of %3.</p>",
+               "<p>The camera clock deviation has been set to %1 seconds.</p><p>It matches %2 "
+               "to the loaded tracks with a median distance of %3.</p>",
+               result.deviation,
+               i18np("one of the tagged images", "%1 of the tagged images", result.anchors),
+               i18np("one meter", "%1 meters", qRound(result.medianDistance))));
+}
+
+void MainWindow::updateLiveMatching()
+{
+    if (! m_fixDriftWidget->liveMatching() || m_geoDataModel->rowCount() == 0) {
+        return;
+    }
+
+    if (m_liveMatcher.isNull()) {
+        // Set up the live matcher with all images that have neither been tagged manually nor
+        // already had coordinates when they were loaded, along with their current matches, so that
+        // only actual changes are applied later on. The images' own coordinates are left alone,
+        // they are also what the clock deviation estimation relies on.
+
+        m_gpxEngine->setMatchParameters(m_automaticMatchingWidget->exactMatchTolerance(),
+                                        m_automaticMatchingWidget->maximumInterpolationInterval(),
+                                        m_automaticMatchingWidget->maximumInterpolationDistance());
+
+        QVector<QString> paths;
+        QVector<qint64> times;
+        QVector<TrackMatcher::Match> matches;
+        for (const auto &path : m_imagesModel->allImages()) {
+            const auto matchType = m_imagesModel->matchType(path);
+            if (matchType == KGeoTag::ManuallySet
+                || m_imagesModel->originalCoordinates(path).isSet()) {
+
+                continue;
+            }
+
+            TrackMatcher::Match match;
+            if (matchType != KGeoTag::NotMatched) {
+                match.coordinates = m_imagesModel->coordinates(path);
+                match.matchType = matchType;
+            }
+
+            paths.append(path);
+            times.append(m_imagesModel->date(path).toMSecsSinceEpoch());
+            matches.append(match);
+        }
+
+        m_liveMatcher.reset(new LiveMatcher(m_gpxEngine->matcher(), paths, times, matches));
+    }
+
+    const auto changed = m_liveMatcher->update(m_fixDriftWidget->cameraClockDeviation());
+    if (changed.isEmpty()) {
+        return;
+    }
+
+    QVector<QString> exactPaths;
+    QVector<Coordinates> exactCoordinates;
+    QVector<QString> interpolatedPaths;
+    QVector<Coordinates> interpolatedCoordinates;
+    QVector<QString> unmatchedPaths;
+
+    for (int image : changed) {
+        const auto &path = m_liveMatcher->path(image);
+
+        // Don't touch images that have been tagged manually in the meantime
+        if (m_imagesModel->matchType(path) == KGeoTag::ManuallySet) {
+            continue;
+        }
+
+        const auto &match = m_liveMatcher->match(image);
+        switch (match.matchType) {
+        case KGeoTag::ExactMatch:
+            exactPaths.append(path);
+            exactCoordinates.append(match.coordinates);
+            break;
+        case KGeoTag::InterpolatedMatch:
+            interpolatedPaths.append(path);
+            interpolatedCoordinates.append(match.coordinates);
+            break;
+        default:
+            unmatchedPaths.append(path);
+        }
+    }
+
+    m_imagesModel->setCoordinates(exactPaths, exactCoordinates, KGeoTag::ExactMatch);
+    m_imagesModel->setCoordinates(interpolatedPaths, interpolatedCoordinates,
+                                  KGeoTag::InterpolatedMatch);
+    m_imagesModel->resetChanges(unmatchedPaths);
+    m_mapWidget->reloadMap();
 }
 
 void MainWindow::removeImages(ImagesListView *list)
@@ -1690,6 +2128,7 @@ void MainWindow::removeTracks()
     }
     m_tracksView->blockSignals(false);
     m_mapWidget->reloadMap();
+    updateTrackTimeZones();
 }
 
 void MainWindow::removeAllTracks()
@@ -1698,6 +2137,16 @@ void MainWindow::removeAllTracks()
     m_geoDataModel->removeAllTracks();
     m_tracksView->blockSignals(false);
     m_mapWidget->reloadMap();
+    updateTrackTimeZones();
+}
+
+void MainWindow::updateTrackTimeZones()
+{
+    // The images' timezones depend on the loaded tracks if they are taken from them. This also
+    // has to be done without any images loaded, so that the ones added later use them.
+    if (m_fixDriftWidget->trackTimeZones()) {
+        imagesTimeZoneChanged();
+    }
 }
 
 void MainWindow::removeEverything()
@@ -1719,9 +2168,10 @@ void MainWindow::removeEverything()
 
 void MainWindow::centerTrackPoint(int trackIndex, int trackPointIndex)
 {
-    const auto dateTime = m_geoDataModel->dateTimes().at(trackIndex).at(trackPointIndex)
+    const auto &trackPoints = m_geoDataModel->trackPoints().at(trackIndex);
+    const auto dateTime = QDateTime::fromMSecsSinceEpoch(trackPoints.time(trackPointIndex), Qt::UTC)
                               .toTimeZone(m_fixDriftWidget->imagesTimeZone());
-    const auto coordinates = m_geoDataModel->trackPoints().at(trackIndex).value(dateTime);
+    const auto coordinates = trackPoints.coordinates(trackPointIndex);
     m_mapWidget->blockSignals(true);
     m_mapWidget->centerCoordinates(coordinates);
     m_mapCenterInfo->trackPointCentered(coordinates, dateTime);
@@ -1740,15 +2190,17 @@ void MainWindow::findClosestTrackPoint(const QString &path)
     const auto point = m_gpxEngine->findClosestTrackPoint(
         m_imagesModel->date(path), m_fixDriftWidget->cameraClockDeviation());
 
-    if (! point.first.isSet()) {
+    if (point.first == -1) {
         QMessageBox::warning(this, i18n("Find closest trackpoint"),
                              i18n("No geodata has been loaded yet!"));
         return;
     }
 
-    m_mapWidget->blockSignals(true);
-    m_mapWidget->centerCoordinates(point.first);
-    m_mapCenterInfo->trackPointCentered(point.first,
-        point.second.toTimeZone(m_fixDriftWidget->imagesTimeZone()));
-    m_mapWidget->blockSignals(false);
+    // Select the respective track without zooming to it and set the track walker to the point
+    m_tracksView->blockSignals(true);
+    m_tracksView->setCurrentIndex(m_geoDataModel->index(point.first, 0));
+    m_tracksView->blockSignals(false);
+    m_trackWalker->setToTrackPoint(point.first, point.second);
+
+    centerTrackPoint(point.first, point.second);
 }
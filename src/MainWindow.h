@@ -9,10 +9,14 @@
 #include "KGeoTag.h"
 #include "ElevationEngine.h"
 #include "Coordinates.h"
+#include "LiveMatcher.h"
 
 // KDE includes
 #include <KXmlGuiWindow>
 
+// Qt includes
+#include <QScopedPointer>
+
 // Local classes
 class SharedObjects;
 class Settings;
@@ -25,6 +29,7 @@ class ImagesModel;
 class ImagesListView;
 class AutomaticMatchingWidget;
 class TracksListView;
+class TrackWalker;
 class GeoDataModel;
 class MapCenterInfo;
 
@@ -76,6 +81,9 @@ private Q_SLOTS:
     void lookupElevation(ImagesListView *list);
     void imagesTimeZoneChanged();
     void cameraDriftSettingsChanged();
+    void liveMatchingToggled(bool state);
+    void estimateCameraClockDeviation();
+    void updateLiveMatching();
     void centerTrackPoint(int trackIndex, int trackPointIndex);
 
     void removeImages(ImagesListView *list);
@@ -95,6 +103,7 @@ private: // Functions
     QString skipRetryCancelText(int processed, int allImages) const;
     bool checkForPendingChanges();
     void saveChanges(const QVector<QString> &files);
+    void updateTrackTimeZones();
 
 private: // Variables
     SharedObjects *m_sharedObjects;
@@ -109,8 +118,12 @@ private: // Variables
     GeoDataModel *m_geoDataModel;
     AutomaticMatchingWidget *m_automaticMatchingWidget;
     TracksListView *m_tracksView;
+    TrackWalker *m_trackWalker;
     MapCenterInfo *m_mapCenterInfo;
 
+    // Only set up while live matching is enabled, and reset each time images or tracks change
+    QScopedPointer<LiveMatcher> m_liveMatcher;
+
     QDockWidget *m_previewDock;
     QDockWidget *m_fixDriftDock;
     QDockWidget *m_automaticMatchingDock;
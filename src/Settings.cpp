@@ -96,6 +96,10 @@ static const QVector<QString> s_elevationDatasets = {
 static const QString &s_defaultElevationDataset = s_elevationDatasets.at(0);
 static const QLatin1String s_dataset("dataset");
 
+// Timezone detection
+static const QLatin1String s_timeZoneDetection("timeZoneDetection");
+static const QLatin1String s_exactBorders("exactBorders");
+
 // Saving
 static const QLatin1String s_saving("saving");
 static const QVector<QString> s_writeModes = {
@@ -393,6 +397,21 @@ QString Settings::elevationDataset() const
     return s_elevationDatasets.contains(dataset) ? dataset : s_defaultElevationDataset;
 }
 
+// Timezone detection
+
+void Settings::saveExactTimeZoneBorders(bool state)
+{
+    auto group = m_config->group(s_timeZoneDetection);
+    group.writeEntry(s_exactBorders, state);
+    group.sync();
+}
+
+bool Settings::exactTimeZoneBorders() const
+{
+    auto group = m_config->group(s_timeZoneDetection);
+    return group.readEntry(s_exactBorders, false);
+}
+
 // Saving
 
 void Settings::saveWriteMode(const QString &writeMode)
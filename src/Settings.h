@@ -68,6 +68,9 @@ public:
     void saveElevationDataset(const QString &id);
     QString elevationDataset() const;
 
+    void saveExactTimeZoneBorders(bool state);
+    bool exactTimeZoneBorders() const;
+
     void saveTrackColor(const QColor &color);
     QColor trackColor() const;
 
@@ -5,6 +5,7 @@
 // Local includes
 #include "SettingsDialog.h"
 #include "Settings.h"
+#include "GpxEngine.h"
 
 // KDE includes
 #include <KLocalizedString>
@@ -25,6 +26,7 @@
 #include <QScrollBar>
 #include <QMessageBox>
 #include <QHBoxLayout>
+#include <QStandardPaths>
 
 SettingsDialog::SettingsDialog(Settings *settings, QWidget *parent)
     : QDialog(parent), m_settings(settings)
@@ -248,6 +250,41 @@ SettingsDialog::SettingsDialog(Settings *settings, QWidget *parent)
     m_lookupElevationAutomatically->setChecked(m_settings->lookupElevationAutomatically());
     elevationBoxLayout->addWidget(m_lookupElevationAutomatically);
 
+    // Timezone detection
+
+    auto *timeZoneBox = new QGroupBox(i18n("Timezone detection"));
+    auto *timeZoneBoxLayout = new QVBoxLayout(timeZoneBox);
+    layout->addWidget(timeZoneBox);
+
+    auto *timeZoneLookupLayout = new QHBoxLayout;
+    timeZoneBoxLayout->addLayout(timeZoneLookupLayout);
+
+    timeZoneLookupLayout->addWidget(new QLabel(i18n("Timezone borders:")));
+
+    m_timeZoneBorders = new QComboBox;
+    m_timeZoneBorders->addItem(i18n("Timezone map (fast)"), false);
+    m_timeZoneBorders->addItem(i18n("Timezone polygons (exact)"), true);
+    m_timeZoneBorders->setCurrentIndex(
+        m_timeZoneBorders->findData(m_settings->exactTimeZoneBorders()));
+    timeZoneLookupLayout->addWidget(m_timeZoneBorders);
+
+    timeZoneLookupLayout->addStretch();
+
+    const auto polygonsDirectory = QStandardPaths::writableLocation(
+                                       QStandardPaths::AppDataLocation);
+    auto *timeZoneInfoLabel = new QLabel(i18n(
+        "<p>The map shipped with KGeoTag has a limited resolution, so that places near a timezone "
+        "border can get the wrong timezone.</p>"
+        "<p>Exact borders need the timezone polygons as a GeoJSON file (e.g. a simplified version "
+        "of the <a href=\"https://github.com/evansiroky/timezone-boundary-builder/\">"
+        "timezone-boundary-builder</a> data), saved as <kbd>%1</kbd> in <kbd>%2</kbd>. If it "
+        "can't be found, the map is used. Changing the setting also updates the timezones of "
+        "the already loaded tracks.</p>",
+        GpxEngine::timeZonePolygonsFile, polygonsDirectory));
+    timeZoneInfoLabel->setWordWrap(true);
+    timeZoneInfoLabel->setOpenExternalLinks(true);
+    timeZoneBoxLayout->addWidget(timeZoneInfoLabel);
+
     // Data saving
 
     auto *saveBox = new QGroupBox(i18n("Saving"));
@@ -352,6 +389,8 @@ void SettingsDialog::accept()
     m_settings->saveLookupElevationAutomatically(m_lookupElevationAutomatically->isChecked());
     m_settings->saveElevationDataset(m_elevationDataset->currentData().toString());
 
+    m_settings->saveExactTimeZoneBorders(m_timeZoneBorders->currentData().toBool());
+
     m_settings->saveWriteMode(m_writeMode->currentData().toString());
     m_settings->saveAllowWriteRawFiles(m_allowWriteRawFiles->isChecked());
     m_settings->saveCreateBackups(m_createBackups->isChecked());
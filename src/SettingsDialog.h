@@ -61,6 +61,8 @@ private: // Variables
     QCheckBox *m_lookupElevationAutomatically;
     QComboBox *m_elevationDataset;
 
+    QComboBox *m_timeZoneBorders;
+
     QComboBox *m_writeMode;
     QCheckBox *m_allowWriteRawFiles;
     QCheckBox *m_createBackups;
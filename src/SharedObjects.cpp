@@ -18,7 +18,7 @@ SharedObjects::SharedObjects(QObject *parent) : QObject(parent)
     m_imagesModel = new ImagesModel(this, m_settings->splitImagesList(),
                                     m_settings->thumbnailSize(), m_settings->previewSize());
     m_geoDataModel = new GeoDataModel(this);
-    m_gpxEngine = new GpxEngine(this, m_geoDataModel);
+    m_gpxEngine = new GpxEngine(this, m_geoDataModel, m_settings->exactTimeZoneBorders());
     m_elevationEngine = new ElevationEngine(this, m_settings);
     m_mapWidget = new MapWidget(this);
     m_coordinatesFormatter = new CoordinatesFormatter(this, &m_locale);
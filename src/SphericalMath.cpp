@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    Great circle distance and interpolation, done the same way as Marble's GeoDataCoordinates
+    sphericalDistanceTo() and interpolate() do it (haversine formula and a spherical linear
+    interpolation of the points' unit vectors), but without constructing GeoDataCoordinates and
+    quaternions for each point.
+*/
+
+// Local includes
+#include "SphericalMath.h"
+#include "KGeoTag.h"
+
+// C++ includes
+#include <cmath>
+#include <algorithm>
+
+namespace SphericalMath
+{
+
+static constexpr double s_degToRad = KGeoTag::pi / 180.0;
+static constexpr double s_radToDeg = 180.0 / KGeoTag::pi;
+
+double distance(double lon1, double lat1, double lon2, double lat2)
+{
+    // Returns the distance between two points given in degrees in meters
+
+    lon1 *= s_degToRad;
+    lat1 *= s_degToRad;
+    lon2 *= s_degToRad;
+    lat2 *= s_degToRad;
+
+    const double h1 = std::sin(0.5 * (lat2 - lat1));
+    const double h2 = std::sin(0.5 * (lon2 - lon1));
+    const double d = h1 * h1 + std::cos(lat1) * std::cos(lat2) * h2 * h2;
+
+    return 2.0 * std::atan2(std::sqrt(d), std::sqrt(1.0 - d)) * KGeoTag::earthRadius;
+}
+
+Coordinates interpolate(const Coordinates &from, const Coordinates &to, double fraction)
+{
+    // Returns the point at the given fraction (0 to 1) of the great circle between both points
+
+    const double fromLon = from.lon() * s_degToRad;
+    const double fromLat = from.lat() * s_degToRad;
+    const double toLon = to.lon() * s_degToRad;
+    const double toLat = to.lat() * s_degToRad;
+
+    // Unit vectors of both points (with the same axes Marble's quaternions use)
+    const double fromCosLat = std::cos(fromLat);
+    const double x1 = fromCosLat * std::sin(fromLon);
+    const double y1 = std::sin(fromLat);
+    const double z1 = fromCosLat * std::cos(fromLon);
+
+    const double toCosLat = std::cos(toLat);
+    const double x2 = toCosLat * std::sin(toLon);
+    const double y2 = std::sin(toLat);
+    const double z2 = toCosLat * std::cos(toLon);
+
+    const double t = std::clamp(fraction, 0.0, 1.0);
+
+    // Spherical linear interpolation between them
+    const double cosAlpha = std::clamp(x1 * x2 + y1 * y2 + z1 * z2, -1.0, 1.0);
+    const double alpha = std::acos(cosAlpha);
+    const double sinAlpha = std::sin(alpha);
+    const bool distinct = sinAlpha > 0.0;
+    const double divisor = distinct ? sinAlpha : 1.0;
+    const double p1 = distinct ? std::sin((1.0 - t) * alpha) / divisor : 1.0;
+    const double p2 = distinct ? std::sin(t * alpha) / divisor : 0.0;
+
+    const double x = p1 * x1 + p2 * x2;
+    const double y = std::clamp(p1 * y1 + p2 * y2, -1.0, 1.0);
+    const double z = p1 * z1 + p2 * z2;
+
+    return Coordinates(x * x + z * z > 0.00005 ? std::atan2(x, z) * s_radToDeg : 0.0,
+                       std::asin(y) * s_radToDeg,
+                       (1.0 - t) * from.alt() + t * to.alt(),
+                       true);
+}
+
+}
@@ -0,0 +1,19 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef SPHERICALMATH_H
+#define SPHERICALMATH_H
+
+// Local includes
+#include "Coordinates.h"
+
+namespace SphericalMath
+{
+
+double distance(double lon1, double lat1, double lon2, double lat2);
+Coordinates interpolate(const Coordinates &from, const Coordinates &to, double fraction);
+
+}
+
+#endif // SPHERICALMATH_H
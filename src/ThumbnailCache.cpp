@@ -0,0 +1,373 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    The thumbnail cache keeps the images' thumbnails and previews across sessions, so that
+    re-loading known images only means reading their metadata.
+
+    The thumbnails are stored in the shared thumbnail cache as defined by the freedesktop.org
+    Thumbnail Managing Standard: PNG files named after the MD5 hash of the image's URI, placed in
+    the "normal" (128 px), "large" (256 px), "x-large" (512 px) or "xx-large" (1024 px) directory
+    below $XDG_CACHE_HOME/thumbnails. The image's URI and modification time (in seconds) are stored
+    as the "Thumb::URI" and "Thumb::MTime" text keys. This way, we can also use thumbnails created
+    e.g. by a file manager, and vice versa.
+
+    The previews are too big for the shared cache and are stored in KGeoTag's own cache directory
+    (with the same naming), using the following layout (native byte order):
+
+        Header
+        URI, padded to 8 bytes
+        JPEG data (or PNG data for images with an alpha channel)
+
+    An entry is only used if the stored URI and modification time match the image's current ones,
+    and if it's either big enough for the requested size, or if the original image was smaller.
+*/
+
+// Local includes
+#include "ThumbnailCache.h"
+#include "Logging.h"
+
+// Qt includes
+#include <QStandardPaths>
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QBuffer>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QCryptographicHash>
+#include <QUrl>
+#include <QDateTime>
+#include <QDebug>
+
+// C++ includes
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+namespace ThumbnailCache
+{
+
+static const QString s_uriKey = QStringLiteral("Thumb::URI");
+static const QString s_mtimeKey = QStringLiteral("Thumb::MTime");
+
+static constexpr quint32 s_magic = 0x4b475450; // "KGTP"
+static constexpr quint32 s_version = 1;
+
+static constexpr int s_jpegQuality = 90;
+
+struct Header
+{
+    quint32 magic;
+    quint32 version;
+    qint64 lastModified;
+    qint32 uriLength;
+    qint32 size;
+};
+
+static inline qint64 padded(qint64 size)
+{
+    return (size + 7) & ~qint64(7);
+}
+
+static QString fileName(const QByteArray &uri)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(uri, QCryptographicHash::Md5).toHex());
+}
+
+static QString thumbnailsDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+           + QStringLiteral("/thumbnails");
+}
+
+static QString thumbnailFile(int cacheSize, const QByteArray &uri)
+{
+    QString directory;
+    switch (cacheSize) {
+    case 128:
+        directory = QStringLiteral("/normal/");
+        break;
+    case 256:
+        directory = QStringLiteral("/large/");
+        break;
+    case 512:
+        directory = QStringLiteral("/x-large/");
+        break;
+    default:
+        directory = QStringLiteral("/xx-large/");
+    }
+
+    return thumbnailsDirectory() + directory + fileName(uri) + QStringLiteral(".png");
+}
+
+static QString previewsDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+           + QStringLiteral("/previews");
+}
+
+static QString previewFile(const QByteArray &uri)
+{
+    return previewsDirectory() + QStringLiteral("/") + fileName(uri) + QStringLiteral(".cache");
+}
+
+static bool createDirectory(const QString &baseDirectory, const QString &directory)
+{
+    // The cache directories should only be accessible by the user
+
+    if (QFileInfo(directory).isDir()) {
+        return true;
+    }
+
+    const bool baseExists = QFileInfo(baseDirectory).isDir();
+    if (! QDir().mkpath(directory)) {
+        qCDebug(KGeoTagLog) << "Could not create the cache directory" << directory;
+        return false;
+    }
+
+    const auto permissions = QFileDevice::ReadOwner | QFileDevice::WriteOwner
+                             | QFileDevice::ExeOwner;
+    if (! baseExists) {
+        QFile::setPermissions(baseDirectory, permissions);
+    }
+    QFile::setPermissions(directory, permissions);
+
+    return true;
+}
+
+static bool isBigEnough(const QImage &image, int size, int cacheSize)
+{
+    // Cached images are scaled to fit into the cache size, so that they are either big enough to
+    // be scaled down to the requested size, or represent the whole (smaller) original image. We
+    // allow one pixel tolerance for the rounding when scaling.
+
+    if (image.isNull()) {
+        return false;
+    }
+
+    const int longerSide = std::max(image.width(), image.height());
+    return longerSide >= size - 1 || longerSide < cacheSize - 1;
+}
+
+static bool writeThumbnailFile(const QString &fileName, const QByteArray &uri,
+                               const QDateTime &lastModified, QImage image)
+{
+    image.setText(s_uriKey, QString::fromLatin1(uri));
+    image.setText(s_mtimeKey, QString::number(lastModified.toSecsSinceEpoch()));
+    image.setText(QStringLiteral("Software"), QStringLiteral("KGeoTag"));
+
+    QSaveFile file(fileName);
+    QImageWriter writer(&file, "png");
+    if (! file.open(QIODevice::WriteOnly) || ! writer.write(image)) {
+        qCDebug(KGeoTagLog) << "Could not write the thumbnail" << fileName;
+        file.cancelWriting();
+        return false;
+    }
+
+    if (! file.commit()) {
+        qCDebug(KGeoTagLog) << "Could not write the thumbnail" << fileName;
+        return false;
+    }
+
+    // The standard demands the thumbnails to be only readable by the user
+    QFile::setPermissions(fileName, QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+    return true;
+}
+
+static bool readPreviewHeader(QFile &file, const QByteArray &uri, Header &header)
+{
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(Header)) != sizeof(Header)) {
+        return false;
+    }
+
+    if (header.magic != s_magic || header.version != s_version
+        || header.uriLength != uri.size()) {
+
+        return false;
+    }
+
+    // We hash the URI, so we check that we really got the requested image's preview
+    const auto storedUri = file.read(padded(header.uriLength));
+    return storedUri.size() == padded(header.uriLength) && storedUri.left(header.uriLength) == uri;
+}
+
+QByteArray uri(const QString &path)
+{
+    return QUrl::fromLocalFile(QFileInfo(path).absoluteFilePath()).toEncoded();
+}
+
+int thumbnailSize(int size)
+{
+    // Returns the size of the smallest shared cache thumbnails that can be used for the given size
+    // (or 0 if there is none)
+
+    for (int cacheSize = 128; cacheSize <= 1024; cacheSize *= 2) {
+        if (size <= cacheSize) {
+            return cacheSize;
+        }
+    }
+
+    return 0;
+}
+
+QImage readThumbnail(const QByteArray &uri, const QDateTime &lastModified, int size)
+{
+    const int cacheSize = thumbnailSize(size);
+    if (cacheSize == 0) {
+        return QImage();
+    }
+
+    // The text keys are read from the header, so outdated thumbnails are not decoded
+    QImageReader reader(thumbnailFile(cacheSize, uri), "png");
+    if (reader.text(s_uriKey) != QString::fromLatin1(uri)
+        || reader.text(s_mtimeKey) != QString::number(lastModified.toSecsSinceEpoch())) {
+
+        return QImage();
+    }
+
+    const auto image = reader.read();
+    return isBigEnough(image, size, cacheSize) ? image : QImage();
+}
+
+void writeThumbnail(const QByteArray &uri, const QDateTime &lastModified, const QImage &image,
+                    int size)
+{
+    // This is run on a worker thread. The image has to be scaled to fit into the cache size
+    // returned by thumbnailSize(size) already.
+
+    const int cacheSize = thumbnailSize(size);
+    if (cacheSize == 0 || image.isNull()) {
+        return;
+    }
+
+    const auto fileName = thumbnailFile(cacheSize, uri);
+    if (! createDirectory(thumbnailsDirectory(), QFileInfo(fileName).absolutePath())) {
+        return;
+    }
+
+    writeThumbnailFile(fileName, uri, lastModified, image);
+}
+
+QImage readPreview(const QByteArray &uri, const QDateTime &lastModified, int size)
+{
+    QFile file(previewFile(uri));
+    if (! file.open(QIODevice::ReadOnly)) {
+        return QImage();
+    }
+
+    Header header;
+    if (! readPreviewHeader(file, uri, header)
+        || header.lastModified != lastModified.toMSecsSinceEpoch()) {
+
+        return QImage();
+    }
+
+    const auto image = QImage::fromData(file.readAll());
+    return isBigEnough(image, size, header.size) ? image : QImage();
+}
+
+void writePreview(const QByteArray &uri, const QDateTime &lastModified, const QImage &image,
+                  int size)
+{
+    // This is run on a worker thread. The image has to be scaled to fit into the given size
+    // already.
+
+    if (image.isNull()) {
+        return;
+    }
+
+    const auto fileName = previewFile(uri);
+    if (! createDirectory(QFileInfo(previewsDirectory()).absolutePath(), previewsDirectory())) {
+        return;
+    }
+
+    // We use JPEG, as the previews are comparably big and don't need to be lossless
+    QByteArray imageData;
+    QBuffer buffer(&imageData);
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer(&buffer, image.hasAlphaChannel() ? "png" : "jpg");
+    writer.setQuality(s_jpegQuality);
+    if (! writer.write(image)) {
+        qCDebug(KGeoTagLog) << "Could not encode the preview for" << uri;
+        return;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    header.magic = s_magic;
+    header.version = s_version;
+    header.lastModified = lastModified.toMSecsSinceEpoch();
+    header.uriLength = uri.size();
+    header.size = size;
+
+    static const char padding[8] = {};
+    const auto uriPadding = padded(uri.size()) - uri.size();
+
+    QSaveFile file(fileName);
+    if (! file.open(QIODevice::WriteOnly)
+        || file.write(reinterpret_cast<const char *>(&header), sizeof(Header)) != sizeof(Header)
+        || file.write(uri) != uri.size()
+        || file.write(padding, uriPadding) != uriPadding
+        || file.write(imageData) != imageData.size()) {
+
+        qCDebug(KGeoTagLog) << "Could not write the preview cache file" << fileName;
+        file.cancelWriting();
+        return;
+    }
+
+    if (! file.commit()) {
+        qCDebug(KGeoTagLog) << "Could not write the preview cache file" << fileName;
+    }
+}
+
+void updateLastModified(const QByteArray &uri, const QDateTime &oldLastModified,
+                        const QDateTime &lastModified)
+{
+    // Writing the metadata changes the image's modification time, but not the image itself. So
+    // we update the cached thumbnails and previews that match the image's former state, so that
+    // they stay valid after saving.
+
+    if (! oldLastModified.isValid() || ! lastModified.isValid()
+        || oldLastModified == lastModified) {
+
+        return;
+    }
+
+    const auto oldMTime = QString::number(oldLastModified.toSecsSinceEpoch());
+    for (int cacheSize = 128; cacheSize <= 1024; cacheSize *= 2) {
+        const auto fileName = thumbnailFile(cacheSize, uri);
+        QImageReader reader(fileName, "png");
+        if (reader.text(s_uriKey) != QString::fromLatin1(uri)
+            || reader.text(s_mtimeKey) != oldMTime) {
+
+            continue;
+        }
+
+        const auto image = reader.read();
+        if (! image.isNull()) {
+            writeThumbnailFile(fileName, uri, lastModified, image);
+        }
+    }
+
+    QFile file(previewFile(uri));
+    Header header;
+    if (! file.open(QIODevice::ReadWrite) || ! readPreviewHeader(file, uri, header)
+        || header.lastModified != oldLastModified.toMSecsSinceEpoch()) {
+
+        return;
+    }
+
+    // Only the header's modification time has to be changed
+    const qint64 msecs = lastModified.toMSecsSinceEpoch();
+    if (! file.seek(offsetof(Header, lastModified))
+        || file.write(reinterpret_cast<const char *>(&msecs), sizeof(qint64)) != sizeof(qint64)) {
+
+        qCDebug(KGeoTagLog) << "Could not update the preview cache file" << file.fileName();
+    }
+}
+
+}
@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+// Qt includes
+#include <QByteArray>
+#include <QImage>
+
+// Qt classes
+class QString;
+class QDateTime;
+
+namespace ThumbnailCache
+{
+
+QByteArray uri(const QString &path);
+int thumbnailSize(int size);
+QImage readThumbnail(const QByteArray &uri, const QDateTime &lastModified, int size);
+void writeThumbnail(const QByteArray &uri, const QDateTime &lastModified, const QImage &image,
+                    int size);
+QImage readPreview(const QByteArray &uri, const QDateTime &lastModified, int size);
+void writePreview(const QByteArray &uri, const QDateTime &lastModified, const QImage &image,
+                  int size);
+void updateLastModified(const QByteArray &uri, const QDateTime &oldLastModified,
+                        const QDateTime &lastModified);
+
+}
+
+#endif // THUMBNAILCACHE_H
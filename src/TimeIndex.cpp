@@ -0,0 +1,118 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    The TimeIndex merges the time-sorted points of all loaded tracks into one timeline, so that
+    a lookup is a single binary search, regardless of how many files are loaded.
+
+    Each entry consists of the point's time, the track (i. e. the GeoDataModel row) and the
+    point's index in the track's time order (cf. TrackPoints::time()).
+
+    Adding a track merges it in linear time. Points with the same time keep the order in which
+    their tracks were loaded, so that the first loaded file wins, like before.
+*/
+
+// Local includes
+#include "TimeIndex.h"
+#include "TrackPoints.h"
+
+// C++ includes
+#include <algorithm>
+
+TimeIndex::TimeIndex()
+{
+}
+
+void TimeIndex::addTrack(int track, const TrackPoints &trackPoints)
+{
+    const int oldCount = m_times.count();
+    const int newCount = trackPoints.count();
+
+    QVector<qint64> times;
+    QVector<int> tracks;
+    QVector<int> points;
+    times.reserve(oldCount + newCount);
+    tracks.reserve(oldCount + newCount);
+    points.reserve(oldCount + newCount);
+
+    int oldIndex = 0;
+    int newIndex = 0;
+
+    while (oldIndex < oldCount || newIndex < newCount) {
+        if (newIndex == newCount
+            || (oldIndex < oldCount && m_times.at(oldIndex) <= trackPoints.time(newIndex))) {
+
+            times.append(m_times.at(oldIndex));
+            tracks.append(m_tracks.at(oldIndex));
+            points.append(m_points.at(oldIndex));
+            oldIndex++;
+
+        } else {
+            times.append(trackPoints.time(newIndex));
+            tracks.append(track);
+            points.append(newIndex);
+            newIndex++;
+        }
+    }
+
+    m_times = times;
+    m_tracks = tracks;
+    m_points = points;
+}
+
+void TimeIndex::removeTrack(int track)
+{
+    int target = 0;
+
+    for (int i = 0; i < m_times.count(); i++) {
+        const int currentTrack = m_tracks.at(i);
+        if (currentTrack == track) {
+            continue;
+        }
+
+        // All tracks after the removed one move up one row
+        m_times[target] = m_times.at(i);
+        m_tracks[target] = currentTrack > track ? currentTrack - 1 : currentTrack;
+        m_points[target] = m_points.at(i);
+        target++;
+    }
+
+    m_times.resize(target);
+    m_tracks.resize(target);
+    m_points.resize(target);
+}
+
+void TimeIndex::clear()
+{
+    m_times.clear();
+    m_tracks.clear();
+    m_points.clear();
+}
+
+int TimeIndex::count() const
+{
+    return m_times.count();
+}
+
+qint64 TimeIndex::time(int index) const
+{
+    return m_times.at(index);
+}
+
+int TimeIndex::track(int index) const
+{
+    return m_tracks.at(index);
+}
+
+int TimeIndex::point(int index) const
+{
+    return m_points.at(index);
+}
+
+int TimeIndex::lowerBound(qint64 time) const
+{
+    // Returns the index of the first entry not earlier than time, or count() if there's none
+    return std::lower_bound(m_times.constBegin(), m_times.constEnd(), time)
+           - m_times.constBegin();
+}
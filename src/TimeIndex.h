@@ -0,0 +1,37 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef TIMEINDEX_H
+#define TIMEINDEX_H
+
+// Qt includes
+#include <QVector>
+
+// Local classes
+class TrackPoints;
+
+class TimeIndex
+{
+
+public:
+    explicit TimeIndex();
+
+    void addTrack(int track, const TrackPoints &trackPoints);
+    void removeTrack(int track);
+    void clear();
+
+    int count() const;
+    qint64 time(int index) const;
+    int track(int index) const;
+    int point(int index) const;
+    int lowerBound(qint64 time) const;
+
+private: // Variables
+    QVector<qint64> m_times;
+    QVector<int> m_tracks;
+    QVector<int> m_points;
+
+};
+
+#endif // TIMEINDEX_H
@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef TIMEZONEDATA_H
+#define TIMEZONEDATA_H
+
+/*
+    Layout of the compiled timezone data file (timezones.bin), written by the
+    kgeotag_compile_timezones build tool and memory mapped by TimeZoneMap.
+
+    The map is stored run-length encoded, row by row. All values are in little endian byte order,
+    so that the file doesn't depend on the machine it has been generated on (e.g. when
+    cross-compiling). Each section is padded to 8 bytes:
+
+        Header
+        Index of the first run of each row, plus the total run count (quint32, height + 1)
+        End x position (exclusive) of each run (quint16)
+        Timezone of each run (quint16, index in the ID table plus one, or 0 for none)
+        Offset of each ID in the ID data, plus the ID data's length (quint32, zoneCount + 1)
+        ID data (the timezones' IANA IDs, concatenated)
+*/
+
+// Qt includes
+#include <QtGlobal>
+
+namespace TimeZoneData
+{
+
+static constexpr quint32 magic = 0x4b47545a; // "KGTZ"
+static constexpr quint32 version = 2;
+
+struct Header
+{
+    quint32 magic;
+    quint32 version;
+    qint32 width;
+    qint32 height;
+    qint32 zoneCount;
+    qint32 idDataLength;
+    qint32 runCount;
+    qint32 reserved;
+};
+
+inline qint64 padded(qint64 size)
+{
+    return (size + 7) & ~qint64(7);
+}
+
+}
+
+#endif // TIMEZONEDATA_H
@@ -0,0 +1,404 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    The timezone data consists of an equirectangular map with one unique color per timezone and
+    a JSON file mapping the colors to the timezones' IANA IDs.
+
+    When loading it, we convert the map to an indexed raster, holding the index of each pixel's
+    timezone in a table of the IDs. This way, a lookup is a single array read, and the map takes
+    half the memory of the decoded image (and no color names and JSON objects are needed at all).
+    There are more than 256 timezones, so we need 16 bits per pixel.
+
+    Normally, we don't have to do this at all: During the build, the map is compiled to a
+    run-length encoded binary file (cf. TimeZoneData.h), which we simply memory map. A lookup then
+    is a binary search in the runs of the respective row. Only the pages actually accessed are read
+    from disk, and neither an image has to be decoded nor JSON has to be parsed. The PNG and JSON
+    files are only used as a fallback if the compiled data is not available.
+
+    If exact timezone borders are requested and the polygon data is available, the coordinates
+    are looked up in the polygons (cf. TimeZonePolygons) first. The raster is still used for
+    everything they don't cover.
+*/
+
+// Local includes
+#include "TimeZoneMap.h"
+#include "TimeZoneData.h"
+#include "Logging.h"
+
+// Qt includes
+#include <QDebug>
+#include <QString>
+#include <QImage>
+#include <QColor>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QHash>
+#include <QTimeZone>
+#include <QtEndian>
+#include <QSysInfo>
+
+// C++ includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cstring>
+
+template<typename T>
+static const T *littleEndianData(const uchar *data, int count, QVector<T> &converted)
+{
+    // The compiled data is stored in little endian byte order. On little endian machines (i.e.
+    // almost all), we can use the mapped data as-is. Otherwise, we have to convert it first.
+
+    if (QSysInfo::ByteOrder == QSysInfo::LittleEndian) {
+        return reinterpret_cast<const T *>(data);
+    }
+
+    converted.resize(count);
+    qFromLittleEndian<T>(data, count, converted.data());
+    return converted.constData();
+}
+
+TimeZoneMap::TimeZoneMap()
+{
+}
+
+void TimeZoneMap::clear()
+{
+    m_width = 0;
+    m_height = 0;
+    m_raster.clear();
+    m_compiledData.reset();
+    m_rowStarts = nullptr;
+    m_runEnds = nullptr;
+    m_runZones = nullptr;
+    m_convertedRowStarts.clear();
+    m_convertedRunEnds.clear();
+    m_convertedRunZones.clear();
+    m_polygons = TimeZonePolygons();
+    m_zoneIds.clear();
+}
+
+void TimeZoneMap::checkZoneIds() const
+{
+    const auto allTimeZones = QTimeZone::availableTimeZoneIds();
+    QVector<QByteArray> invalidIds;
+    for (const auto &id : m_zoneIds) {
+        if (! allTimeZones.contains(id)) {
+            invalidIds.append(id);
+        }
+    }
+
+    if (invalidIds.count() > 0) {
+        qCWarning(KGeoTagLog) << "Found" << invalidIds.count() << "unusable timezone ID(s)!";
+        qCWarning(KGeoTagLog) << "    The following IDs are not represented in "
+                              << "QTimeZone::availableTimeZoneIds():";
+        for (const auto &id : invalidIds) {
+            qCWarning(KGeoTagLog) << "   " << id;
+        }
+    }
+}
+
+bool TimeZoneMap::loadCompiled(const QString &dataFile)
+{
+    clear();
+
+    auto file = QSharedPointer<QFile>::create(dataFile);
+    if (! file->open(QIODevice::ReadOnly)) {
+        qCWarning(KGeoTagLog) << "Failed to open the compiled timezone data file!";
+        return false;
+    }
+
+    const auto size = file->size();
+    const auto *data = size >= qint64(sizeof(TimeZoneData::Header)) ? file->map(0, size) : nullptr;
+    if (data == nullptr) {
+        qCWarning(KGeoTagLog) << "Failed to map the compiled timezone data file!";
+        return false;
+    }
+
+    // Check if the file is what we expect
+
+    TimeZoneData::Header header;
+    std::memcpy(&header, data, sizeof(TimeZoneData::Header));
+    header.magic = qFromLittleEndian(header.magic);
+    header.version = qFromLittleEndian(header.version);
+    header.width = qFromLittleEndian(header.width);
+    header.height = qFromLittleEndian(header.height);
+    header.zoneCount = qFromLittleEndian(header.zoneCount);
+    header.idDataLength = qFromLittleEndian(header.idDataLength);
+    header.runCount = qFromLittleEndian(header.runCount);
+
+    if (header.magic != TimeZoneData::magic || header.version != TimeZoneData::version
+        || header.width <= 0 || header.height <= 0 || header.zoneCount <= 0
+        || header.zoneCount >= std::numeric_limits<quint16>::max()
+        || header.idDataLength < 0 || header.runCount < header.height) {
+
+        qCWarning(KGeoTagLog) << "Invalid or outdated compiled timezone data file!";
+        return false;
+    }
+
+    const auto rowStartsOffset = TimeZoneData::padded(sizeof(TimeZoneData::Header));
+    const auto runEndsOffset = rowStartsOffset
+        + TimeZoneData::padded((qint64(header.height) + 1) * qint64(sizeof(quint32)));
+    const auto runZonesOffset = runEndsOffset
+        + TimeZoneData::padded(qint64(header.runCount) * qint64(sizeof(quint16)));
+    const auto idOffsetsOffset = runZonesOffset
+        + TimeZoneData::padded(qint64(header.runCount) * qint64(sizeof(quint16)));
+    const auto idDataOffset = idOffsetsOffset
+        + TimeZoneData::padded((qint64(header.zoneCount) + 1) * qint64(sizeof(quint32)));
+
+    if (idDataOffset + header.idDataLength > size) {
+        qCWarning(KGeoTagLog) << "The compiled timezone data file is truncated!";
+        return false;
+    }
+
+    QVector<quint32> idOffsetsData;
+    const auto *rowStarts = littleEndianData(data + rowStartsOffset, header.height + 1,
+                                             m_convertedRowStarts);
+    const auto *runEnds = littleEndianData(data + runEndsOffset, header.runCount,
+                                           m_convertedRunEnds);
+    const auto *runZones = littleEndianData(data + runZonesOffset, header.runCount,
+                                            m_convertedRunZones);
+    const auto *idOffsets = littleEndianData(data + idOffsetsOffset, header.zoneCount + 1,
+                                             idOffsetsData);
+    const auto *idData = reinterpret_cast<const char *>(data + idDataOffset);
+
+    // Check the index data once, so that we can rely on it for all lookups. Each row has to hold
+    // at least one run, and its last run has to end at the map's right edge.
+    if (rowStarts[0] != 0 || rowStarts[header.height] != quint32(header.runCount)) {
+        qCWarning(KGeoTagLog) << "Invalid row index in the compiled timezone data file!";
+        return false;
+    }
+    for (int y = 0; y < header.height; y++) {
+        if (rowStarts[y] >= rowStarts[y + 1]
+            || runEnds[rowStarts[y + 1] - 1] != quint32(header.width)) {
+
+            qCWarning(KGeoTagLog) << "Invalid row index in the compiled timezone data file!";
+            return false;
+        }
+    }
+    for (int i = 0; i < header.runCount; i++) {
+        if (runZones[i] > header.zoneCount) {
+            qCWarning(KGeoTagLog) << "Invalid timezone in the compiled timezone data file!";
+            return false;
+        }
+    }
+
+    // Read the IDs
+
+    for (int i = 0; i < header.zoneCount; i++) {
+        if (idOffsets[i] > idOffsets[i + 1]
+            || idOffsets[i + 1] > quint32(header.idDataLength)) {
+
+            qCWarning(KGeoTagLog) << "Invalid ID table in the compiled timezone data file!";
+            m_zoneIds.clear();
+            return false;
+        }
+        m_zoneIds.append(QByteArray(idData + idOffsets[i], idOffsets[i + 1] - idOffsets[i]));
+    }
+
+    checkZoneIds();
+
+    m_width = header.width;
+    m_height = header.height;
+    m_compiledData = file;
+    m_rowStarts = rowStarts;
+    m_runEnds = runEnds;
+    m_runZones = runZones;
+
+    qCDebug(KGeoTagLog) << "Mapped the compiled timezone data from" << dataFile << "("
+                        << m_zoneIds.count() << "timezones," << header.runCount << "runs for a"
+                        << m_width << "x" << m_height << "map," << size / 1024 << "KiB)";
+
+    return true;
+}
+
+bool TimeZoneMap::load(const QString &imageFile, const QString &mappingFile)
+{
+    clear();
+
+    // Load the color-timezone mapping
+
+    QFile jsonData(mappingFile);
+    if (! jsonData.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qCWarning(KGeoTagLog) << "Failed to load the timezone mapping data file!";
+        return false;
+    }
+    const auto mapping = QJsonDocument::fromJson(jsonData.readAll()).object();
+    jsonData.close();
+
+    if (mapping.isEmpty()
+        || mapping.count() >= std::numeric_limits<quint16>::max()) {
+
+        qCWarning(KGeoTagLog) << "Could not load any timezone IDs!";
+        return false;
+    }
+
+    QHash<QRgb, quint16> colorIndices;
+    for (auto it = mapping.constBegin(); it != mapping.constEnd(); it++) {
+        m_zoneIds.append(it.value().toString().toUtf8());
+        colorIndices.insert(QColor(it.key()).rgb() & RGB_MASK, m_zoneIds.count());
+    }
+
+    qCDebug(KGeoTagLog) << "Loaded" << m_zoneIds.count() << "timezone IDs from" << mappingFile;
+
+    // Check if all listed timezones are valid
+    checkZoneIds();
+
+    // Convert the map image to the indexed raster
+
+    auto image = QImage(imageFile);
+    if (image.isNull()) {
+        qCWarning(KGeoTagLog) << "Failed to load the timezones map file!";
+        m_zoneIds.clear();
+        return false;
+    }
+    image = image.convertToFormat(QImage::Format_ARGB32);
+
+    m_width = image.width();
+    m_height = image.height();
+    m_raster.resize(m_width * m_height);
+
+    auto *pixel = m_raster.data();
+    for (int y = 0; y < m_height; y++) {
+        const auto *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < m_width; x++) {
+            *pixel++ = colorIndices.value(line[x] & RGB_MASK, 0);
+        }
+    }
+
+    qCDebug(KGeoTagLog) << "Loaded the timezones map from" << imageFile << "as a" << m_width
+                        << "x" << m_height << "raster ("
+                        << m_raster.count() * int(sizeof(quint16)) / 1024 << "KiB)";
+
+    return true;
+}
+
+bool TimeZoneMap::isLoaded() const
+{
+    return (! m_raster.isEmpty() || m_compiledData) && ! m_zoneIds.isEmpty();
+}
+
+int TimeZoneMap::pixel(double lon, double lat) const
+{
+    // Returns the position of the given coordinates in the map as y * width + x, or -1 if they
+    // are outside of it
+
+    // Scale the coordinates to the raster size, relative to its center
+    int x = std::round(lon / 180.0 * (m_width / 2.0));
+    int y = std::round(lat / 90.0 * (m_height / 2.0));
+
+    // Move the mapped coordinates to the left lower edge
+    x = m_width / 2 + x;
+    y = m_height - (m_height / 2 + y);
+
+    return x >= 0 && x < m_width && y >= 0 && y < m_height ? y * m_width + x : -1;
+}
+
+int TimeZoneMap::pixelZoneIndex(int pixel) const
+{
+    if (m_compiledData) {
+        // Find the run containing x, i.e. the first one ending after it
+        const int y = pixel / m_width;
+        const auto *begin = m_runEnds + m_rowStarts[y];
+        const auto *end = m_runEnds + m_rowStarts[y + 1];
+        const auto *run = std::upper_bound(begin, end, quint16(pixel - y * m_width));
+        return int(m_runZones[run - m_runEnds]) - 1;
+    }
+
+    return int(m_raster.at(pixel)) - 1;
+}
+
+bool TimeZoneMap::loadPolygons(const QString &file)
+{
+    // The raster has to be loaded first, as the polygons share (and extend) its ID table
+    if (! isLoaded()) {
+        return false;
+    }
+
+    const auto zoneCount = m_zoneIds.count();
+    if (! m_polygons.load(file, m_zoneIds)) {
+        m_zoneIds.resize(zoneCount);
+        return false;
+    }
+
+    checkZoneIds();
+    return true;
+}
+
+bool TimeZoneMap::hasPolygons() const
+{
+    return m_polygons.isLoaded();
+}
+
+int TimeZoneMap::zoneIndex(double lon, double lat) const
+{
+    // Returns the index of the timezone at the given coordinates, or -1 if there's none
+
+    if (! isLoaded()) {
+        return -1;
+    }
+
+    if (m_polygons.isLoaded()) {
+        const int index = m_polygons.zoneIndex(lon, lat);
+        if (index != -1) {
+            return index;
+        }
+    }
+
+    const int index = pixel(lon, lat);
+    return index == -1 ? -1 : pixelZoneIndex(index);
+}
+
+void TimeZoneMap::zoneIndices(int count, const double *lons, const double *lats,
+                              int *indices) const
+{
+    // Looks up the timezone index of a whole array of coordinates (-1 for none)
+
+    if (! isLoaded()) {
+        std::fill(indices, indices + count, -1);
+        return;
+    }
+
+    if (m_polygons.isLoaded()) {
+        int hint = -1;
+        for (int i = 0; i < count; i++) {
+            indices[i] = m_polygons.zoneIndex(lons[i], lats[i], hint);
+            if (indices[i] == -1) {
+                const int index = pixel(lons[i], lats[i]);
+                indices[i] = index == -1 ? -1 : pixelZoneIndex(index);
+            }
+        }
+        return;
+    }
+
+    // First map all coordinates to pixels
+    for (int i = 0; i < count; i++) {
+        indices[i] = pixel(lons[i], lats[i]);
+    }
+
+    // Then resolve the pixels. Consecutive track points mostly hit the same pixel, so we only
+    // search the map if the pixel changed.
+    int lastPixel = -1;
+    int lastZone = -1;
+    for (int i = 0; i < count; i++) {
+        const int current = indices[i];
+        if (current != lastPixel) {
+            lastPixel = current;
+            lastZone = current == -1 ? -1 : pixelZoneIndex(current);
+        }
+        indices[i] = lastZone;
+    }
+}
+
+QByteArray TimeZoneMap::zoneId(int index) const
+{
+    return index >= 0 && index < m_zoneIds.count() ? m_zoneIds.at(index) : QByteArray();
+}
+
+QByteArray TimeZoneMap::zoneId(double lon, double lat) const
+{
+    return zoneId(zoneIndex(lon, lat));
+}
@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef TIMEZONEMAP_H
+#define TIMEZONEMAP_H
+
+// Local includes
+#include "TimeZonePolygons.h"
+
+// Qt includes
+#include <QVector>
+#include <QByteArray>
+#include <QSharedPointer>
+
+// Qt classes
+class QString;
+class QFile;
+
+class TimeZoneMap
+{
+
+public:
+    explicit TimeZoneMap();
+    bool load(const QString &imageFile, const QString &mappingFile);
+    bool loadCompiled(const QString &dataFile);
+    bool loadPolygons(const QString &file);
+    bool hasPolygons() const;
+    bool isLoaded() const;
+    int zoneIndex(double lon, double lat) const;
+    void zoneIndices(int count, const double *lons, const double *lats, int *indices) const;
+    QByteArray zoneId(int index) const;
+    QByteArray zoneId(double lon, double lat) const;
+
+private: // Functions
+    void clear();
+    void checkZoneIds() const;
+    int pixel(double lon, double lat) const;
+    int pixelZoneIndex(int pixel) const;
+
+private: // Variables
+    int m_width = 0;
+    int m_height = 0;
+
+    // One entry per pixel: The index of the pixel's timezone in m_zoneIds plus one, or 0 if the
+    // pixel has none
+    QVector<quint16> m_raster;
+
+    // The memory mapped compiled data (cf. TimeZoneData.h), shared by all copies
+    QSharedPointer<QFile> m_compiledData;
+    const quint32 *m_rowStarts = nullptr;
+    const quint16 *m_runEnds = nullptr;
+    const quint16 *m_runZones = nullptr;
+
+    // Only used on big endian machines, where the compiled data can't be used directly
+    QVector<quint32> m_convertedRowStarts;
+    QVector<quint16> m_convertedRunEnds;
+    QVector<quint16> m_convertedRunZones;
+
+    // Optionally used before the raster, if the exact borders are requested
+    TimeZonePolygons m_polygons;
+
+    QVector<QByteArray> m_zoneIds;
+
+};
+
+#endif // TIMEZONEMAP_H
@@ -0,0 +1,330 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    TimeZonePolygons is an optional, exact alternative to the rasterized timezone map. It reads
+    the timezones' boundary polygons from a GeoJSON file (like the ones provided by
+    https://github.com/evansiroky/timezone-boundary-builder/, preferably simplified) and looks up
+    coordinates with a point-in-polygon test, so that places near a border get the correct
+    timezone regardless of the map's resolution.
+
+    To avoid testing all polygons, their bounding boxes are indexed by a static R-tree. As the
+    polygons never change, it's bulk loaded once using the "sort-tile-recursive" algorithm: The
+    polygons are sorted into vertical slices by their center's longitude, each slice is sorted by
+    latitude, and then consecutive ones are grouped into nodes. The upper levels simply group
+    consecutive nodes, which are already spatially close this way. The tree is stored level by
+    level in flat arrays, so that no pointers are needed at all.
+
+    The data file is not shipped with KGeoTag (it's way bigger than the map), so the map stays
+    the default and is used as a fallback.
+*/
+
+// Local includes
+#include "TimeZonePolygons.h"
+#include "Logging.h"
+
+// Qt includes
+#include <QDebug>
+#include <QString>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QRegularExpression>
+#include <QHash>
+
+// C++ includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// The maximum number of children of a R-tree node
+static constexpr int s_nodeSize = 16;
+
+static QByteArray qtZoneId(const QString &tzid)
+{
+    // Translates the few IDs differing from the ones used by QTimeZone, just like
+    // compile_timezones_data.py does when creating the timezone map
+
+    static const QRegularExpression etcGmt(QStringLiteral("^Etc/GMT([+-])(\\d+)$"));
+    const auto match = etcGmt.match(tzid);
+    if (match.hasMatch()) {
+        const auto hours = match.captured(2).rightJustified(2, QLatin1Char('0'));
+        return QStringLiteral("UTC%1%2:00").arg(match.captured(1), hours).toUtf8();
+    } else if (tzid == QStringLiteral("Etc/UTC")) {
+        return QByteArrayLiteral("UTC");
+    } else if (tzid == QStringLiteral("Etc/GMT")) {
+        return QByteArrayLiteral("UTC+00:00");
+    }
+
+    return tzid.toUtf8();
+}
+
+TimeZonePolygons::TimeZonePolygons()
+{
+}
+
+bool TimeZonePolygons::load(const QString &file, QVector<QByteArray> &zoneIds)
+{
+    // The timezones are added to zoneIds (if not already present), and the polygons refer to
+    // their index in it
+
+    m_lons.clear();
+    m_lats.clear();
+    m_ringStarts.clear();
+    m_polygonRings.clear();
+    m_polygonZones.clear();
+    m_levels.clear();
+    m_leafPolygons.clear();
+
+    QFile data(file);
+    if (! data.open(QIODevice::ReadOnly)) {
+        qCWarning(KGeoTagLog) << "Failed to open the timezone polygons file" << file;
+        return false;
+    }
+
+    QJsonParseError error;
+    const auto document = QJsonDocument::fromJson(data.readAll(), &error);
+    data.close();
+    if (error.error != QJsonParseError::NoError) {
+        qCWarning(KGeoTagLog) << "Failed to parse the timezone polygons file" << file << ":"
+                              << error.errorString();
+        return false;
+    }
+
+    QHash<QByteArray, int> zoneIndices;
+    for (int i = 0; i < zoneIds.count(); i++) {
+        zoneIndices.insert(zoneIds.at(i), i);
+    }
+
+    const auto addPolygon = [this](const QJsonArray &rings, int zone)
+    {
+        if (rings.isEmpty()) {
+            return;
+        }
+
+        m_polygonRings.append(m_ringStarts.count());
+        for (const auto &ring : rings) {
+            m_ringStarts.append(m_lons.count());
+            const auto points = ring.toArray();
+            for (const auto &point : points) {
+                const auto coordinates = point.toArray();
+                m_lons.append(coordinates.at(0).toDouble());
+                m_lats.append(coordinates.at(1).toDouble());
+            }
+        }
+        m_polygonZones.append(zone);
+    };
+
+    const auto features = document.object().value(QStringLiteral("features")).toArray();
+    for (const auto &value : features) {
+        const auto feature = value.toObject();
+        const auto id = qtZoneId(feature.value(QStringLiteral("properties")).toObject()
+                                        .value(QStringLiteral("tzid")).toString());
+        if (id.isEmpty()) {
+            continue;
+        }
+
+        auto zone = zoneIndices.constFind(id);
+        if (zone == zoneIndices.constEnd()) {
+            zoneIds.append(id);
+            zone = zoneIndices.insert(id, zoneIds.count() - 1);
+        }
+
+        const auto geometry = feature.value(QStringLiteral("geometry")).toObject();
+        const auto type = geometry.value(QStringLiteral("type")).toString();
+        const auto coordinates = geometry.value(QStringLiteral("coordinates")).toArray();
+        if (type == QStringLiteral("Polygon")) {
+            addPolygon(coordinates, zone.value());
+        } else if (type == QStringLiteral("MultiPolygon")) {
+            for (const auto &polygon : coordinates) {
+                addPolygon(polygon.toArray(), zone.value());
+            }
+        }
+    }
+
+    m_ringStarts.append(m_lons.count());
+    m_polygonRings.append(m_ringStarts.count() - 1);
+
+    if (m_polygonZones.isEmpty()) {
+        qCWarning(KGeoTagLog) << "Could not read any timezone polygons from" << file;
+        return false;
+    }
+
+    buildTree();
+
+    qCDebug(KGeoTagLog) << "Loaded" << m_polygonZones.count() << "timezone polygons with"
+                        << m_lons.count() << "vertices from" << file << "(R-tree height"
+                        << m_levels.count() << ")";
+
+    return true;
+}
+
+void TimeZonePolygons::buildTree()
+{
+    const int polygons = m_polygonZones.count();
+
+    // Calculate the polygons' bounding boxes
+
+    QVector<Box> boxes;
+    boxes.reserve(polygons);
+    for (int polygon = 0; polygon < polygons; polygon++) {
+        Box box { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                  std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest() };
+        // The first ring is the outer one
+        const int ring = m_polygonRings.at(polygon);
+        for (int i = m_ringStarts.at(ring); i < m_ringStarts.at(ring + 1); i++) {
+            box.minLon = std::min(box.minLon, m_lons.at(i));
+            box.minLat = std::min(box.minLat, m_lats.at(i));
+            box.maxLon = std::max(box.maxLon, m_lons.at(i));
+            box.maxLat = std::max(box.maxLat, m_lats.at(i));
+        }
+        boxes.append(box);
+    }
+
+    // Sort the leaves (sort-tile-recursive)
+
+    m_leafPolygons.resize(polygons);
+    for (int i = 0; i < polygons; i++) {
+        m_leafPolygons[i] = i;
+    }
+
+    const auto centerLon = [&boxes](int polygon)
+    {
+        return boxes.at(polygon).minLon + boxes.at(polygon).maxLon;
+    };
+    const auto centerLat = [&boxes](int polygon)
+    {
+        return boxes.at(polygon).minLat + boxes.at(polygon).maxLat;
+    };
+
+    std::sort(m_leafPolygons.begin(), m_leafPolygons.end(), [&centerLon](int a, int b)
+    {
+        return centerLon(a) < centerLon(b);
+    });
+
+    const int leafNodes = (polygons + s_nodeSize - 1) / s_nodeSize;
+    const int slices = std::ceil(std::sqrt(double(leafNodes)));
+    const int sliceSize = slices * s_nodeSize;
+    for (int start = 0; start < polygons; start += sliceSize) {
+        const auto end = m_leafPolygons.begin() + std::min(start + sliceSize, polygons);
+        std::sort(m_leafPolygons.begin() + start, end, [&centerLat](int a, int b)
+        {
+            return centerLat(a) < centerLat(b);
+        });
+    }
+
+    QVector<Box> leaves;
+    leaves.reserve(polygons);
+    for (int polygon : std::as_const(m_leafPolygons)) {
+        leaves.append(boxes.at(polygon));
+    }
+    m_levels.append(leaves);
+
+    // Build the upper levels until only one node is left
+
+    while (m_levels.last().count() > 1) {
+        const auto &lower = m_levels.last();
+        QVector<Box> level;
+        level.reserve((lower.count() + s_nodeSize - 1) / s_nodeSize);
+        for (int start = 0; start < lower.count(); start += s_nodeSize) {
+            auto box = lower.at(start);
+            for (int i = start + 1; i < std::min(start + s_nodeSize, lower.count()); i++) {
+                const auto &child = lower.at(i);
+                box.minLon = std::min(box.minLon, child.minLon);
+                box.minLat = std::min(box.minLat, child.minLat);
+                box.maxLon = std::max(box.maxLon, child.maxLon);
+                box.maxLat = std::max(box.maxLat, child.maxLat);
+            }
+            level.append(box);
+        }
+        m_levels.append(level);
+    }
+}
+
+bool TimeZonePolygons::isLoaded() const
+{
+    return ! m_levels.isEmpty();
+}
+
+int TimeZonePolygons::count() const
+{
+    return m_polygonZones.count();
+}
+
+bool TimeZonePolygons::polygonContains(int polygon, double lon, double lat) const
+{
+    // Even-odd rule ray casting over all rings, so that holes are excluded without any special
+    // handling
+
+    bool inside = false;
+    for (int ring = m_polygonRings.at(polygon); ring < m_polygonRings.at(polygon + 1); ring++) {
+        const int start = m_ringStarts.at(ring);
+        const int end = m_ringStarts.at(ring + 1);
+        if (end - start < 3) {
+            continue;
+        }
+
+        for (int i = start, j = end - 1; i < end; j = i++) {
+            const double lonI = m_lons.at(i);
+            const double latI = m_lats.at(i);
+            const double lonJ = m_lons.at(j);
+            const double latJ = m_lats.at(j);
+            if ((latI > lat) != (latJ > lat)
+                && lon < (lonJ - lonI) * (lat - latI) / (latJ - latI) + lonI) {
+
+                inside = ! inside;
+            }
+        }
+    }
+
+    return inside;
+}
+
+int TimeZonePolygons::search(int level, int node, double lon, double lat) const
+{
+    // Returns the polygon containing the given coordinates below the given node, or -1
+
+    if (! m_levels.at(level).at(node).contains(lon, lat)) {
+        return -1;
+    }
+
+    if (level == 0) {
+        const int polygon = m_leafPolygons.at(node);
+        return polygonContains(polygon, lon, lat) ? polygon : -1;
+    }
+
+    const int end = std::min((node + 1) * s_nodeSize, m_levels.at(level - 1).count());
+    for (int child = node * s_nodeSize; child < end; child++) {
+        const int polygon = search(level - 1, child, lon, lat);
+        if (polygon != -1) {
+            return polygon;
+        }
+    }
+
+    return -1;
+}
+
+int TimeZonePolygons::zoneIndex(double lon, double lat) const
+{
+    int hint = -1;
+    return zoneIndex(lon, lat, hint);
+}
+
+int TimeZonePolygons::zoneIndex(double lon, double lat, int &hint) const
+{
+    // Returns the index of the timezone containing the given coordinates, or -1 if there's none.
+    // hint is the polygon found by the last lookup: Consecutive track points are mostly located
+    // in the same one, so that we check it first.
+
+    if (m_levels.isEmpty()) {
+        return -1;
+    }
+
+    if (hint == -1 || ! polygonContains(hint, lon, lat)) {
+        hint = search(m_levels.count() - 1, 0, lon, lat);
+    }
+
+    return hint == -1 ? -1 : m_polygonZones.at(hint);
+}
@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef TIMEZONEPOLYGONS_H
+#define TIMEZONEPOLYGONS_H
+
+// Qt includes
+#include <QVector>
+#include <QByteArray>
+
+// Qt classes
+class QString;
+
+class TimeZonePolygons
+{
+
+public:
+    explicit TimeZonePolygons();
+    bool load(const QString &file, QVector<QByteArray> &zoneIds);
+    bool isLoaded() const;
+    int count() const;
+    int zoneIndex(double lon, double lat) const;
+    int zoneIndex(double lon, double lat, int &hint) const;
+
+private: // Structs
+    struct Box
+    {
+        double minLon;
+        double minLat;
+        double maxLon;
+        double maxLat;
+
+        bool contains(double lon, double lat) const
+        {
+            return lon >= minLon && lon <= maxLon && lat >= minLat && lat <= maxLat;
+        }
+    };
+
+private: // Functions
+    void buildTree();
+    bool polygonContains(int polygon, double lon, double lat) const;
+    int search(int level, int node, double lon, double lat) const;
+
+private: // Variables
+    // All rings' vertices, the index of each ring's first vertex (plus the vertex count), the
+    // index of each polygon's first ring (plus the ring count) and each polygon's timezone
+    QVector<double> m_lons;
+    QVector<double> m_lats;
+    QVector<int> m_ringStarts;
+    QVector<int> m_polygonRings;
+    QVector<int> m_polygonZones;
+
+    // The R-tree's levels, from the leaves (the polygons' bounding boxes) up to the root. Node n
+    // of a level holds the nodes n * s_nodeSize up to n * s_nodeSize + s_nodeSize - 1 of the level
+    // below. m_leafPolygons maps the leaves to the polygons.
+    QVector<QVector<Box>> m_levels;
+    QVector<int> m_leafPolygons;
+
+};
+
+#endif // TIMEZONEPOLYGONS_H
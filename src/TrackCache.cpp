@@ -0,0 +1,251 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    The track cache stores the parsed data of each loaded GPX file in a flat binary file, so that
+    re-opening a known track only means mapping this file and copying the arrays out of it.
+
+    The cache file's name is the SHA-1 hash of the GPX file's canonical path, so that a changed
+    file simply overwrites its outdated cache. The GPX file's size and modification time are
+    stored in the header and have to match the current ones for the cache to be used.
+
+    Layout (native byte order, the magic number doubles as a byte order check):
+
+        Header
+        Canonical path (UTF-8), padded to 8 bytes
+        Detected timezone ID (using the exact timezone borders if set in the header), padded to
+        8 bytes
+        End index of each segment (qint32), padded to 8 bytes
+        Times (qint64, milliseconds since the epoch, TrackPoints::noTime for points without a time)
+        Longitudes (double)
+        Latitudes (double)
+        Altitudes (double)
+*/
+
+// Local includes
+#include "TrackCache.h"
+#include "Logging.h"
+
+// Qt includes
+#include <QStandardPaths>
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QDebug>
+
+// C++ includes
+#include <cstring>
+
+namespace TrackCache
+{
+
+static constexpr quint32 s_magic = 0x4b475443; // "KGTC"
+static constexpr quint32 s_version = 4;
+
+struct Header
+{
+    quint32 magic;
+    quint32 version;
+    qint64 fileSize;
+    qint64 lastModified;
+    qint32 tracks;
+    qint32 segments;
+    qint32 points;
+    qint32 pathLength;
+    qint32 timeZoneIdLength;
+    qint32 exactTimeZoneBorders;
+    qint32 segmentCount;
+    qint64 pointCount;
+};
+
+static inline qint64 padded(qint64 size)
+{
+    return (size + 7) & ~qint64(7);
+}
+
+static QString cacheFile(const QString &canonicalPath)
+{
+    const auto hash = QCryptographicHash::hash(canonicalPath.toUtf8(), QCryptographicHash::Sha1);
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+           + QStringLiteral("/tracks/")
+           + QString::fromLatin1(hash.toHex())
+           + QStringLiteral(".cache");
+}
+
+bool read(const QString &path, GpxEngine::ParsedTrack &parsedTrack)
+{
+    const QFileInfo info(path);
+    const auto canonicalPath = info.canonicalFilePath();
+    if (canonicalPath.isEmpty()) {
+        return false;
+    }
+
+    QFile file(cacheFile(canonicalPath));
+    if (! file.exists() || ! file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const auto size = file.size();
+    if (size < qint64(sizeof(Header))) {
+        return false;
+    }
+
+    const auto *data = reinterpret_cast<const char *>(file.map(0, size));
+    if (data == nullptr) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+
+    if (header.magic != s_magic || header.version != s_version
+        || header.fileSize != info.size()
+        || header.lastModified != info.lastModified().toMSecsSinceEpoch()
+        || header.pathLength < 0 || header.timeZoneIdLength < 0
+        || header.segmentCount < 0 || header.pointCount < 0) {
+
+        return false;
+    }
+
+    const auto pathOffset = qint64(sizeof(Header));
+    const auto timeZoneIdOffset = pathOffset + padded(header.pathLength);
+    const auto segmentsOffset = timeZoneIdOffset + padded(header.timeZoneIdLength);
+    const auto timesOffset = segmentsOffset + padded(header.segmentCount * qint64(sizeof(qint32)));
+    const auto arraySize = header.pointCount * qint64(sizeof(double));
+    const auto lonOffset = timesOffset + arraySize;
+    const auto latOffset = lonOffset + arraySize;
+    const auto altOffset = latOffset + arraySize;
+
+    if (altOffset + arraySize != size) {
+        qCDebug(KGeoTagLog) << "Discarding malformed cache file" << file.fileName();
+        return false;
+    }
+
+    // We hash the path, so we check that we really got the requested file's cache
+    if (QString::fromUtf8(data + pathOffset, header.pathLength) != canonicalPath) {
+        return false;
+    }
+
+    QVector<int> segmentEnds(header.segmentCount);
+    std::memcpy(segmentEnds.data(), data + segmentsOffset, header.segmentCount * sizeof(qint32));
+
+    int lastEnd = 0;
+    for (const auto end : segmentEnds) {
+        if (end <= lastEnd) {
+            return false;
+        }
+        lastEnd = end;
+    }
+    if (lastEnd != header.pointCount) {
+        return false;
+    }
+
+    const auto copy = [data, &header](auto &vector, qint64 offset)
+    {
+        vector.resize(header.pointCount);
+        std::memcpy(vector.data(), data + offset, header.pointCount * sizeof(vector.at(0)));
+    };
+
+    QVector<qint64> times;
+    QVector<double> lons;
+    QVector<double> lats;
+    QVector<double> alts;
+    copy(times, timesOffset);
+    copy(lons, lonOffset);
+    copy(lats, latOffset);
+    copy(alts, altOffset);
+
+    parsedTrack.trackPoints = TrackPoints(times, lons, lats, alts, segmentEnds);
+    parsedTrack.timeZoneId = QByteArray(data + timeZoneIdOffset, header.timeZoneIdLength);
+    parsedTrack.exactTimeZoneBorders = header.exactTimeZoneBorders != 0;
+    parsedTrack.fileSize = header.fileSize;
+    parsedTrack.lastModified = header.lastModified;
+    parsedTrack.info = { GpxEngine::Okay, header.tracks, header.segments, header.points };
+    parsedTrack.fromCache = true;
+
+    return true;
+}
+
+void write(const GpxEngine::ParsedTrack &parsedTrack)
+{
+    // This is run on a worker thread after a freshly parsed track has been added
+
+    const QFileInfo info(parsedTrack.path);
+    const auto canonicalPath = info.canonicalFilePath();
+    if (canonicalPath.isEmpty()) {
+        return;
+    }
+
+    // Don't cache anything if the file has been changed in the meantime
+    if (info.size() != parsedTrack.fileSize
+        || info.lastModified().toMSecsSinceEpoch() != parsedTrack.lastModified) {
+
+        return;
+    }
+
+    const auto fileName = cacheFile(canonicalPath);
+    if (! QDir().mkpath(QFileInfo(fileName).absolutePath())) {
+        qCDebug(KGeoTagLog) << "Could not create the track cache directory for" << fileName;
+        return;
+    }
+
+    const auto path = canonicalPath.toUtf8();
+
+    const auto &trackPoints = parsedTrack.trackPoints;
+    const qint64 pointCount = trackPoints.pointCount();
+
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    header.magic = s_magic;
+    header.version = s_version;
+    header.fileSize = parsedTrack.fileSize;
+    header.lastModified = parsedTrack.lastModified;
+    header.tracks = parsedTrack.info.tracks;
+    header.segments = parsedTrack.info.segments;
+    header.points = parsedTrack.info.points;
+    header.pathLength = path.size();
+    header.timeZoneIdLength = parsedTrack.timeZoneId.size();
+    header.exactTimeZoneBorders = parsedTrack.exactTimeZoneBorders ? 1 : 0;
+    header.segmentCount = trackPoints.segmentCount();
+    header.pointCount = pointCount;
+
+    const auto writePadded = [](QSaveFile &file, const void *data, qint64 size)
+    {
+        static const char padding[8] = {};
+        return file.write(static_cast<const char *>(data), size) == size
+               && file.write(padding, padded(size) - size) == padded(size) - size;
+    };
+
+    QSaveFile file(fileName);
+    if (! file.open(QIODevice::WriteOnly)
+        || ! writePadded(file, &header, sizeof(Header))
+        || ! writePadded(file, path.constData(), path.size())
+        || ! writePadded(file, parsedTrack.timeZoneId.constData(), parsedTrack.timeZoneId.size())
+        || ! writePadded(file, trackPoints.segmentEnds().constData(),
+                         trackPoints.segmentCount() * sizeof(qint32))
+        || ! writePadded(file, trackPoints.times().constData(),
+                         pointCount * sizeof(qint64))
+        || ! writePadded(file, trackPoints.lons().constData(),
+                         pointCount * sizeof(double))
+        || ! writePadded(file, trackPoints.lats().constData(),
+                         pointCount * sizeof(double))
+        || ! writePadded(file, trackPoints.alts().constData(),
+                         pointCount * sizeof(double))) {
+
+        qCDebug(KGeoTagLog) << "Could not write the track cache file" << fileName;
+        file.cancelWriting();
+        return;
+    }
+
+    if (! file.commit()) {
+        qCDebug(KGeoTagLog) << "Could not write the track cache file" << fileName;
+        return;
+    }
+
+    qCDebug(KGeoTagLog) << "Cached" << parsedTrack.path << "as" << fileName;
+}
+
+}
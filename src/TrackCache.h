@@ -0,0 +1,22 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef TRACKCACHE_H
+#define TRACKCACHE_H
+
+// Local includes
+#include "GpxEngine.h"
+
+// Qt includes
+#include <QString>
+
+namespace TrackCache
+{
+
+bool read(const QString &path, GpxEngine::ParsedTrack &parsedTrack);
+void write(const GpxEngine::ParsedTrack &parsedTrack);
+
+}
+
+#endif // TRACKCACHE_H
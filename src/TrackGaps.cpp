@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    TrackGaps holds the duration and the distance of each gap between two consecutive points of
+    a track (in time order, so gap n is the one between the points n and n + 1 of
+    TrackPoints::time() and TrackPoints::coordinates()). Both never change, so they are calculated
+    once when the track is loaded.
+
+    Additionally, it keeps a bit for each gap telling whether it exceeds the current maximum
+    interpolation interval or distance. This is only updated when the limits are changed, so that
+    checking them while matching is a plain lookup.
+*/
+
+// Local includes
+#include "TrackGaps.h"
+#include "TrackPoints.h"
+#include "SphericalMath.h"
+
+// C++ includes
+#include <algorithm>
+
+TrackGaps::TrackGaps()
+{
+}
+
+TrackGaps::TrackGaps(const TrackPoints &trackPoints)
+{
+    const int count = std::max(trackPoints.count() - 1, 0);
+    m_durations.resize(count);
+    m_distances.resize(count);
+    m_exceedsLimits.resize(count);
+
+    if (count == 0) {
+        return;
+    }
+
+    auto before = trackPoints.coordinates(0);
+    for (int i = 0; i < count; i++) {
+        const auto after = trackPoints.coordinates(i + 1);
+        m_durations[i] = trackPoints.time(i + 1) - trackPoints.time(i);
+        m_distances[i] = SphericalMath::distance(before.lon(), before.lat(),
+                                                 after.lon(), after.lat());
+        before = after;
+    }
+}
+
+void TrackGaps::setLimits(int maximumInterval, int maximumDistance)
+{
+    // The maximum interval is given in seconds, the durations are milliseconds
+    const qint64 maximumDuration = qint64(maximumInterval) * 1000;
+
+    for (int i = 0; i < m_durations.count(); i++) {
+        m_exceedsLimits.setBit(i,
+            (maximumInterval != -1 && m_durations.at(i) > maximumDuration)
+            || (maximumDistance != -1 && m_distances.at(i) > maximumDistance));
+    }
+}
+
+int TrackGaps::count() const
+{
+    return m_durations.count();
+}
+
+qint64 TrackGaps::duration(int gap) const
+{
+    return m_durations.at(gap);
+}
+
+double TrackGaps::distance(int gap) const
+{
+    return m_distances.at(gap);
+}
+
+bool TrackGaps::usable(int gap) const
+{
+    return ! m_exceedsLimits.testBit(gap);
+}
@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef TRACKGAPS_H
+#define TRACKGAPS_H
+
+// Qt includes
+#include <QVector>
+#include <QBitArray>
+
+// Local classes
+class TrackPoints;
+
+class TrackGaps
+{
+
+public:
+    explicit TrackGaps();
+    explicit TrackGaps(const TrackPoints &trackPoints);
+
+    void setLimits(int maximumInterval, int maximumDistance);
+
+    int count() const;
+    qint64 duration(int gap) const;
+    double distance(int gap) const;
+    bool usable(int gap) const;
+
+private: // Variables
+    QVector<qint64> m_durations;
+    QVector<double> m_distances;
+    QBitArray m_exceedsLimits;
+
+};
+
+#endif // TRACKGAPS_H
@@ -0,0 +1,286 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    A TrackMatcher holds (implicitly shared) copies of the merged time index and the track points
+    of all loaded tracks, along with the match parameters. It never changes, so it can be used on
+    any number of threads at once, while tracks are added or removed in the meantime.
+*/
+
+// Local includes
+#include "TrackMatcher.h"
+#include "Logging.h"
+#include "debugMode.h"
+#include "SphericalMath.h"
+
+// Qt includes
+#include <QDebug>
+#include <QPair>
+
+#ifdef DEBUG_MODE
+#include <QElapsedTimer>
+#endif
+
+// C++ includes
+#include <cmath>
+#include <utility>
+#include <algorithm>
+
+TrackMatcher::TrackMatcher(const TimeIndex &timeIndex, const QVector<TrackPoints> &trackPoints,
+                           const QVector<TrackGaps> &trackGaps, int exactMatchTolerance)
+    : m_timeIndex(timeIndex),
+      m_trackPoints(trackPoints),
+      m_trackGaps(trackGaps),
+      m_exactMatchTolerance(qint64(exactMatchTolerance) * 1000)
+{
+}
+
+QVector<TrackMatcher::Match> TrackMatcher::findMatches(const QVector<qint64> &times,
+                                                       KGeoTag::SearchType searchType) const
+{
+    // The times are expected to be sorted (with the camera's clock deviation already applied).
+    // Instead of doing a binary search for each of them, we walk through the merged time index
+    // alongside, so that all times are matched in one linear pass.
+
+#ifdef DEBUG_MODE
+    QElapsedTimer timer;
+    timer.start();
+#endif
+
+    const int count = m_timeIndex.count();
+
+    QVector<Match> matches(times.count());
+
+    int lowerBound = 0;
+    qint64 lastTime = 0;
+
+    for (int i = 0; i < times.count(); i++) {
+        const auto time = times.at(i);
+
+        if (i > 0 && time < lastTime) {
+            // Not sorted after all, so we have to search for this one
+            lowerBound = m_timeIndex.lowerBound(time);
+        } else {
+            while (lowerBound < count && m_timeIndex.time(lowerBound) < time) {
+                lowerBound++;
+            }
+        }
+        lastTime = time;
+
+        auto &match = matches[i];
+
+        if (searchType == KGeoTag::CombinedMatchSearch
+            || searchType == KGeoTag::ExactMatchSearch) {
+
+            match.coordinates = exactCoordinates(time, lowerBound);
+            if (match.coordinates.isSet()) {
+                match.matchType = KGeoTag::ExactMatch;
+                continue;
+            }
+        }
+
+        if (searchType == KGeoTag::CombinedMatchSearch
+            || searchType == KGeoTag::InterpolatedMatchSearch) {
+
+            match.coordinates = interpolatedCoordinates(time, lowerBound);
+            if (match.coordinates.isSet()) {
+                match.matchType = KGeoTag::InterpolatedMatch;
+            }
+        }
+    }
+
+#ifdef DEBUG_MODE
+    qCDebug(KGeoTagLog) << "Matched" << times.count() << "times against" << count
+                        << "track points in" << timer.nsecsElapsed() / 1000000.0 << "ms";
+#endif
+
+    return matches;
+}
+
+TrackMatcher::Match TrackMatcher::findMatch(qint64 time, int lowerBound) const
+{
+    // Does a combined match search for a single time
+    Match match;
+
+    match.coordinates = exactCoordinates(time, lowerBound);
+    if (match.coordinates.isSet()) {
+        match.matchType = KGeoTag::ExactMatch;
+        return match;
+    }
+
+    match.coordinates = interpolatedCoordinates(time, lowerBound);
+    if (match.coordinates.isSet()) {
+        match.matchType = KGeoTag::InterpolatedMatch;
+    }
+
+    return match;
+}
+
+int TrackMatcher::lowerBound(qint64 time, int hint) const
+{
+    // Returns the same as TimeIndex::lowerBound(), but starts looking at the given index. If the
+    // time is still between the same two points, this is a constant time check. Otherwise, we
+    // step outwards with growing steps and search the range found this way, so that a small
+    // change of the time only needs a few comparisons.
+
+    const int count = m_timeIndex.count();
+    hint = std::clamp(hint, 0, count);
+
+    if (hint < count && m_timeIndex.time(hint) < time) {
+        int low = hint + 1;
+        int step = 1;
+        while (low + step < count && m_timeIndex.time(low + step) < time) {
+            low += step + 1;
+            step *= 2;
+        }
+        int high = std::min(low + step, count);
+        while (low < high) {
+            const int middle = low + (high - low) / 2;
+            if (m_timeIndex.time(middle) < time) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    if (hint > 0 && m_timeIndex.time(hint - 1) >= time) {
+        int high = hint - 1;
+        int step = 1;
+        while (high - step > 0 && m_timeIndex.time(high - step - 1) >= time) {
+            high -= step + 1;
+            step *= 2;
+        }
+        int low = std::max(high - step, 0);
+        while (low < high) {
+            const int middle = low + (high - low) / 2;
+            if (m_timeIndex.time(middle) < time) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+
+    return hint;
+}
+
+Coordinates TrackMatcher::indexedCoordinates(int index) const
+{
+    return m_trackPoints.at(m_timeIndex.track(index)).coordinates(m_timeIndex.point(index));
+}
+
+int TrackMatcher::closestIndex(qint64 time, int lowerBound) const
+{
+    // lowerBound is the index of the first point not earlier than the requested time. The
+    // closest point is either this one or the one before. All loaded files are searched at once
+    // via the merged index. An earlier point with the same deviation wins.
+
+    if (m_timeIndex.count() == 0) {
+        return -1;
+    }
+
+    if (lowerBound == m_timeIndex.count()
+        || (lowerBound > 0
+            && time - m_timeIndex.time(lowerBound - 1) <= m_timeIndex.time(lowerBound) - time)) {
+
+        return lowerBound - 1;
+    }
+
+    return lowerBound;
+}
+
+Coordinates TrackMatcher::exactCoordinates(qint64 time, int lowerBound) const
+{
+    const int index = closestIndex(time, lowerBound);
+
+    // Check if the closest point is within the maximum tolerable deviation
+    if (index == -1 || std::abs(m_timeIndex.time(index) - time) > m_exactMatchTolerance) {
+        return Coordinates();
+    }
+
+    return indexedCoordinates(index);
+}
+
+Coordinates TrackMatcher::interpolatedCoordinates(qint64 time, int lowerBound) const
+{
+    // If the image's date is after the last point we have, it can't be assigned
+    if (lowerBound == m_timeIndex.count()) {
+        return Coordinates();
+    }
+
+    // Check for an exact match (without tolerance)
+    if (m_timeIndex.time(lowerBound) == time) {
+        return indexedCoordinates(lowerBound);
+    }
+
+    int track;
+    int pointBefore;
+    if (! findInterpolationPoints(time, lowerBound, track, pointBefore)) {
+        return Coordinates();
+    }
+
+    const auto &trackPoints = m_trackPoints.at(track);
+    return SphericalMath::interpolate(trackPoints.coordinates(pointBefore),
+                                      trackPoints.coordinates(pointBefore + 1),
+                                      interpolationFraction(track, pointBefore, time));
+}
+
+bool TrackMatcher::findInterpolationPoints(qint64 time, int lowerBound, int &track,
+                                           int &pointBefore) const
+{
+    // If the image's date is before the first point we have, it can't be assigned
+    if (lowerBound == 0) {
+        return false;
+    }
+
+    // We only interpolate between two points of the same track. The closest points before and
+    // after the image's date normally belong to the same one. If they don't, the tracks overlap,
+    // and we try both the track of the point before and the one of the point after, the one with
+    // the shorter interval around the image's date first.
+
+    const int trackBefore = m_timeIndex.track(lowerBound - 1);
+    const int indexBefore = m_timeIndex.point(lowerBound - 1);
+    const int trackAfter = m_timeIndex.track(lowerBound);
+    const int indexAfter = m_timeIndex.point(lowerBound);
+
+    QPair<int, int> candidates[2];
+    int candidatesCount = 0;
+    if (indexBefore + 1 < m_trackPoints.at(trackBefore).count()) {
+        candidates[candidatesCount++] = qMakePair(trackBefore, indexBefore);
+    }
+    if (trackAfter != trackBefore && indexAfter > 0) {
+        candidates[candidatesCount++] = qMakePair(trackAfter, indexAfter - 1);
+    }
+
+    if (candidatesCount == 2) {
+        const auto interval = [this](const QPair<int, int> &candidate)
+        {
+            return m_trackGaps.at(candidate.first).duration(candidate.second);
+        };
+        if (interval(candidates[1]) < interval(candidates[0])) {
+            std::swap(candidates[0], candidates[1]);
+        }
+    }
+
+    for (int i = 0; i < candidatesCount; i++) {
+        // The gaps exceeding the maximum interval or distance have been looked up in advance
+        if (m_trackGaps.at(candidates[i].first).usable(candidates[i].second)) {
+            track = candidates[i].first;
+            pointBefore = candidates[i].second;
+            return true;
+        }
+    }
+
+    // No usable pair of points found
+    return false;
+}
+
+double TrackMatcher::interpolationFraction(int track, int pointBefore, qint64 time) const
+{
+    return double(time - m_trackPoints.at(track).time(pointBefore))
+           / double(m_trackGaps.at(track).duration(pointBefore));
+}
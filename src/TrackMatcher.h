@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef TRACKMATCHER_H
+#define TRACKMATCHER_H
+
+// Local includes
+#include "KGeoTag.h"
+#include "Coordinates.h"
+#include "TimeIndex.h"
+#include "TrackPoints.h"
+#include "TrackGaps.h"
+
+// Qt includes
+#include <QVector>
+
+class TrackMatcher
+{
+
+public:
+    struct Match
+    {
+        Coordinates coordinates;
+        KGeoTag::MatchType matchType = KGeoTag::NotMatched;
+    };
+
+    explicit TrackMatcher(const TimeIndex &timeIndex, const QVector<TrackPoints> &trackPoints,
+                          const QVector<TrackGaps> &trackGaps, int exactMatchTolerance);
+
+    QVector<TrackMatcher::Match> findMatches(const QVector<qint64> &times,
+                                             KGeoTag::SearchType searchType) const;
+    TrackMatcher::Match findMatch(qint64 time, int lowerBound) const;
+    int lowerBound(qint64 time, int hint) const;
+    int closestIndex(qint64 time, int lowerBound) const;
+    Coordinates indexedCoordinates(int index) const;
+    Coordinates exactCoordinates(qint64 time, int lowerBound) const;
+    Coordinates interpolatedCoordinates(qint64 time, int lowerBound) const;
+
+private: // Functions
+    bool findInterpolationPoints(qint64 time, int lowerBound, int &track, int &pointBefore) const;
+    double interpolationFraction(int track, int pointBefore, qint64 time) const;
+
+private: // Variables
+    TimeIndex m_timeIndex;
+    QVector<TrackPoints> m_trackPoints;
+    QVector<TrackGaps> m_trackGaps;
+    qint64 m_exactMatchTolerance;
+
+};
+
+#endif // TRACKMATCHER_H
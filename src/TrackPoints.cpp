@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    TrackPoints holds all points of a loaded GPX file as a structure of arrays: One array each
+    for the times (milliseconds since the epoch), longitudes, latitudes and altitudes, plus the end
+    index of each segment.
+
+    Matching needs the points sorted by time. Virtually all GPX files are recorded in
+    chronological order, so normally, the file order is used directly. Only if it's not (or if
+    some points lack a time), a permutation of the points with a time, sorted by it, is built.
+*/
+
+// Local includes
+#include "TrackPoints.h"
+
+// C++ includes
+#include <algorithm>
+
+TrackPoints::TrackPoints()
+{
+}
+
+TrackPoints::TrackPoints(const QVector<qint64> &times, const QVector<double> &lons,
+                         const QVector<double> &lats, const QVector<double> &alts,
+                         const QVector<int> &segmentEnds)
+    : m_times(times),
+      m_lons(lons),
+      m_lats(lats),
+      m_alts(alts),
+      m_segmentEnds(segmentEnds)
+{
+    finish();
+}
+
+void TrackPoints::appendPoint(qint64 time, double lon, double lat, double alt)
+{
+    m_times.append(time);
+    m_lons.append(lon);
+    m_lats.append(lat);
+    m_alts.append(alt);
+}
+
+void TrackPoints::closeSegment()
+{
+    // Empty segments are not added
+    const int end = m_lons.count();
+    if (end > (m_segmentEnds.isEmpty() ? 0 : m_segmentEnds.last())) {
+        m_segmentEnds.append(end);
+    }
+}
+
+void TrackPoints::finish()
+{
+    // Drop points that have not been closed by a segment
+    const int end = m_segmentEnds.isEmpty() ? 0 : m_segmentEnds.last();
+    if (m_lons.count() > end) {
+        m_times.resize(end);
+        m_lons.resize(end);
+        m_lats.resize(end);
+        m_alts.resize(end);
+    }
+
+    m_timeOrder.clear();
+    m_inTimeOrder = true;
+
+    for (int i = 0; i < m_times.count(); i++) {
+        if (m_times.at(i) == noTime || (i > 0 && m_times.at(i) < m_times.at(i - 1))) {
+            m_inTimeOrder = false;
+            break;
+        }
+    }
+
+    if (m_inTimeOrder) {
+        return;
+    }
+
+    for (int i = 0; i < m_times.count(); i++) {
+        if (m_times.at(i) != noTime) {
+            m_timeOrder.append(i);
+        }
+    }
+
+    std::stable_sort(m_timeOrder.begin(), m_timeOrder.end(), [this](int a, int b)
+    {
+        return m_times.at(a) < m_times.at(b);
+    });
+}
+
+int TrackPoints::pointCount() const
+{
+    return m_times.count();
+}
+
+int TrackPoints::segmentCount() const
+{
+    return m_segmentEnds.count();
+}
+
+int TrackPoints::segmentStart(int segment) const
+{
+    return segment == 0 ? 0 : m_segmentEnds.at(segment - 1);
+}
+
+int TrackPoints::segmentEnd(int segment) const
+{
+    return m_segmentEnds.at(segment);
+}
+
+qint64 TrackPoints::pointTime(int point) const
+{
+    return m_times.at(point);
+}
+
+Coordinates TrackPoints::pointCoordinates(int point) const
+{
+    return Coordinates(m_lons.at(point), m_lats.at(point), m_alts.at(point), true);
+}
+
+const QVector<qint64> &TrackPoints::times() const
+{
+    return m_times;
+}
+
+const QVector<double> &TrackPoints::lons() const
+{
+    return m_lons;
+}
+
+const QVector<double> &TrackPoints::lats() const
+{
+    return m_lats;
+}
+
+const QVector<double> &TrackPoints::alts() const
+{
+    return m_alts;
+}
+
+const QVector<int> &TrackPoints::segmentEnds() const
+{
+    return m_segmentEnds;
+}
+
+int TrackPoints::count() const
+{
+    return m_inTimeOrder ? m_times.count() : m_timeOrder.count();
+}
+
+int TrackPoints::pointIndex(int index) const
+{
+    return m_inTimeOrder ? index : m_timeOrder.at(index);
+}
+
+qint64 TrackPoints::time(int index) const
+{
+    return m_times.at(pointIndex(index));
+}
+
+Coordinates TrackPoints::coordinates(int index) const
+{
+    return pointCoordinates(pointIndex(index));
+}
+
+int TrackPoints::lowerBound(qint64 time) const
+{
+    // Returns the index of the first point not earlier than time, or count() if there's none
+    int start = 0;
+    int length = count();
+
+    while (length > 0) {
+        const int half = length / 2;
+        if (this->time(start + half) < time) {
+            start += half + 1;
+            length -= half + 1;
+        } else {
+            length = half;
+        }
+    }
+
+    return start;
+}
+
+int TrackPoints::indexOf(qint64 time) const
+{
+    const int index = lowerBound(time);
+    return index < count() && this->time(index) == time ? index : -1;
+}
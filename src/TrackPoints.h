@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef TRACKPOINTS_H
+#define TRACKPOINTS_H
+
+// Local includes
+#include "Coordinates.h"
+
+// Qt includes
+#include <QVector>
+
+// C++ includes
+#include <limits>
+
+class TrackPoints
+{
+
+public:
+    static constexpr qint64 noTime = std::numeric_limits<qint64>::min();
+
+    explicit TrackPoints();
+    explicit TrackPoints(const QVector<qint64> &times, const QVector<double> &lons,
+                         const QVector<double> &lats, const QVector<double> &alts,
+                         const QVector<int> &segmentEnds);
+
+    void appendPoint(qint64 time, double lon, double lat, double alt);
+    void closeSegment();
+    void finish();
+
+    // All points in file order
+    int pointCount() const;
+    int segmentCount() const;
+    int segmentStart(int segment) const;
+    int segmentEnd(int segment) const;
+    qint64 pointTime(int point) const;
+    Coordinates pointCoordinates(int point) const;
+    const QVector<qint64> &times() const;
+    const QVector<double> &lons() const;
+    const QVector<double> &lats() const;
+    const QVector<double> &alts() const;
+    const QVector<int> &segmentEnds() const;
+
+    // All points with a time, sorted by it
+    int count() const;
+    int pointIndex(int index) const;
+    qint64 time(int index) const;
+    Coordinates coordinates(int index) const;
+    int lowerBound(qint64 time) const;
+    int indexOf(qint64 time) const;
+
+private: // Variables
+    QVector<qint64> m_times;
+    QVector<double> m_lons;
+    QVector<double> m_lats;
+    QVector<double> m_alts;
+    QVector<int> m_segmentEnds;
+
+    // Only filled if the points are not already sorted by time or some have no time
+    QVector<int> m_timeOrder;
+    bool m_inTimeOrder = true;
+
+};
+
+#endif // TRACKPOINTS_H
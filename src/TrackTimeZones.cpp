@@ -0,0 +1,116 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    TrackTimeZones splits a track into runs of consecutive points (in time order) located in the
+    same timezone, so that a track crossing timezone borders (like a road trip through several
+    countries) can tell which timezone a given part of it was recorded in.
+
+    All points are looked up in the timezone map in one pass when the track is loaded. Points
+    outside of any timezone don't start a new run, they are attributed to the surrounding one.
+
+    An image's date is a local time without any timezone information. To find the timezone it was
+    taken in, we check for each run if the date, interpreted in the run's timezone, falls into the
+    time span covered by the run. The UTC offsets are calculated once for the start and the end of
+    each run, so that a DST change during a run is handled without any timezone calculation for
+    the single images.
+*/
+
+// Local includes
+#include "TrackTimeZones.h"
+#include "TrackPoints.h"
+#include "TimeZoneMap.h"
+
+// Qt includes
+#include <QTimeZone>
+#include <QDateTime>
+
+TrackTimeZones::TrackTimeZones()
+{
+}
+
+TrackTimeZones::TrackTimeZones(const TrackPoints &trackPoints, const TimeZoneMap &timeZoneMap)
+{
+    const int pointCount = trackPoints.pointCount();
+    if (pointCount == 0 || trackPoints.count() == 0) {
+        return;
+    }
+
+    // Lookup the timezone of all points (in file order) at once
+    QVector<int> zoneIndices(pointCount);
+    timeZoneMap.zoneIndices(pointCount, trackPoints.lons().constData(),
+                            trackPoints.lats().constData(), zoneIndices.data());
+
+    // Collect the runs in time order
+
+    int currentZone = -1;
+    for (int i = 0; i < trackPoints.count(); i++) {
+        const int zone = zoneIndices.at(trackPoints.pointIndex(i));
+        const qint64 time = trackPoints.time(i);
+
+        if (zone != -1 && zone != currentZone) {
+            if (currentZone != -1) {
+                // Let the previous run end where this one starts, so that there are no holes
+                m_ends.last() = time;
+            }
+            currentZone = zone;
+            m_starts.append(time);
+            m_ends.append(time);
+            m_zoneIds.append(timeZoneMap.zoneId(zone));
+
+        } else if (currentZone != -1) {
+            m_ends.last() = time;
+        }
+    }
+
+    // Calculate the UTC offsets
+
+    m_startOffsets.reserve(m_starts.count());
+    m_endOffsets.reserve(m_starts.count());
+    for (int i = 0; i < m_starts.count(); i++) {
+        const QTimeZone timeZone(m_zoneIds.at(i));
+        m_startOffsets.append(qint64(timeZone.offsetFromUtc(
+            QDateTime::fromMSecsSinceEpoch(m_starts.at(i), Qt::UTC))) * 1000);
+        m_endOffsets.append(qint64(timeZone.offsetFromUtc(
+            QDateTime::fromMSecsSinceEpoch(m_ends.at(i), Qt::UTC))) * 1000);
+    }
+}
+
+int TrackTimeZones::count() const
+{
+    return m_starts.count();
+}
+
+qint64 TrackTimeZones::start(int run) const
+{
+    return m_starts.at(run);
+}
+
+qint64 TrackTimeZones::end(int run) const
+{
+    return m_ends.at(run);
+}
+
+const QVector<QByteArray> &TrackTimeZones::zoneIds() const
+{
+    return m_zoneIds;
+}
+
+QByteArray TrackTimeZones::zoneIdForLocalTime(qint64 localTime) const
+{
+    // localTime is the local date and time as milliseconds since the epoch, as if it was UTC.
+    // Returns the timezone of the run it falls into, or an empty QByteArray if there's none.
+
+    for (int i = 0; i < m_starts.count(); i++) {
+        const auto start = m_starts.at(i);
+        const auto end = m_ends.at(i);
+        const auto fromStart = localTime - m_startOffsets.at(i);
+        const auto fromEnd = localTime - m_endOffsets.at(i);
+        if ((fromStart >= start && fromStart <= end) || (fromEnd >= start && fromEnd <= end)) {
+            return m_zoneIds.at(i);
+        }
+    }
+
+    return QByteArray();
+}
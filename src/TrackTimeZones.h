@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+#ifndef TRACKTIMEZONES_H
+#define TRACKTIMEZONES_H
+
+// Qt includes
+#include <QVector>
+#include <QByteArray>
+
+// Local classes
+class TrackPoints;
+class TimeZoneMap;
+
+class TrackTimeZones
+{
+
+public:
+    explicit TrackTimeZones();
+    explicit TrackTimeZones(const TrackPoints &trackPoints, const TimeZoneMap &timeZoneMap);
+
+    int count() const;
+    qint64 start(int run) const;
+    qint64 end(int run) const;
+    const QVector<QByteArray> &zoneIds() const;
+    QByteArray zoneIdForLocalTime(qint64 localTime) const;
+
+private: // Variables
+    QVector<qint64> m_starts;
+    QVector<qint64> m_ends;
+    QVector<QByteArray> m_zoneIds;
+
+    // The UTC offsets (in milliseconds) at the start and the end of each run
+    QVector<qint64> m_startOffsets;
+    QVector<qint64> m_endOffsets;
+
+};
+
+#endif // TRACKTIMEZONES_H
@@ -43,7 +43,7 @@ void TrackWalker::setToTrack(int row)
         return;
     }
 
-    const int count = m_geoDataModel->dateTimes().at(row).count();
+    const int count = m_geoDataModel->trackPoints().at(row).count();
     m_slider->blockSignals(true);
     m_slider->setValue(1);
     m_slider->setMaximum(count);
@@ -52,6 +52,19 @@ void TrackWalker::setToTrack(int row)
     setEnabled(true);
 }
 
+void TrackWalker::setToTrackPoint(int row, int trackPointIndex)
+{
+    if (row != m_trackIndex) {
+        setToTrack(row);
+    }
+
+    m_slider->blockSignals(true);
+    m_slider->setValue(trackPointIndex + 1);
+    m_slider->blockSignals(false);
+    m_info->setText(i18n("Selected trackpoint %1 of %2", trackPointIndex + 1,
+                         m_slider->maximum()));
+}
+
 void TrackWalker::sliderMoved(int index)
 {
     m_info->setText(i18n("Selected trackpoint %1 of %2", index, m_slider->maximum()));
@@ -24,6 +24,7 @@ public:
 
 public Q_SLOTS:
     void setToTrack(int row);
+    void setToTrackPoint(int row, int trackPointIndex);
 
 Q_SIGNALS:
     void trackPointSelected(int trackIndex, int trackPointIndex);
@@ -9,9 +9,13 @@
 
 // Marble includes
 #include <marble/GeoPainter.h>
+#include <marble/ViewportParams.h>
+#include <marble/GeoDataLineString.h>
+#include <marble/GeoDataLatLonAltBox.h>
 
 // C++ includes
 #include <utility>
+#include <cmath>
 
 static QStringList s_renderPosition { QStringLiteral("SURFACE") };
 
@@ -27,14 +31,53 @@ QStringList TracksLayer::renderPosition() const
     return s_renderPosition;
 }
 
-bool TracksLayer::render(Marble::GeoPainter *painter, Marble::ViewportParams *, const QString &,
-                         Marble::GeoSceneLayer *)
+bool TracksLayer::render(Marble::GeoPainter *painter, Marble::ViewportParams *viewport,
+                         const QString &, Marble::GeoSceneLayer *)
 {
+    // We don't keep line strings of the whole tracks, they would hold a second copy of each point.
+    // Instead, we build them from the track points for each rendering. Points closer than a pixel
+    // to the last one drawn are skipped, so that we only create as many coordinates as can be
+    // seen, no matter how many points the tracks have.
+
     painter->setPen(*m_trackPen);
 
-    for (const auto &segments : m_geoDataModel->marbleTracks()) {
-        for (const auto &segment : segments) {
-            painter->drawPolyline(segment);
+    const auto viewportBox = viewport->viewLatLonAltBox();
+    const double resolution = viewport->angularResolution() * 180.0 / KGeoTag::pi;
+    const auto &allTrackPoints = m_geoDataModel->trackPoints();
+
+    for (int track = 0; track < allTrackPoints.count(); track++) {
+        if (! viewportBox.intersects(m_geoDataModel->trackBox(m_geoDataModel->index(track, 0)))) {
+            continue;
+        }
+
+        const auto &trackPoints = allTrackPoints.at(track);
+        const auto &lons = trackPoints.lons();
+        const auto &lats = trackPoints.lats();
+
+        for (int segment = 0; segment < trackPoints.segmentCount(); segment++) {
+            const int start = trackPoints.segmentStart(segment);
+            const int last = trackPoints.segmentEnd(segment) - 1;
+
+            Marble::GeoDataLineString lineString;
+            double lastLon = 0.0;
+            double lastLat = 0.0;
+
+            for (int i = start; i <= last; i++) {
+                const double lon = lons.at(i);
+                const double lat = lats.at(i);
+                if (i != start && i != last && std::abs(lon - lastLon) < resolution
+                    && std::abs(lat - lastLat) < resolution) {
+
+                    continue;
+                }
+
+                lineString.append(Marble::GeoDataCoordinates(lon, lat, 0.0,
+                                                             Marble::GeoDataCoordinates::Degree));
+                lastLon = lon;
+                lastLat = lat;
+            }
+
+            painter->drawPolyline(lineString);
         }
     }
 
@@ -7,7 +7,6 @@
 
 // Marble includes
 #include <marble/LayerInterface.h>
-#include <marble/GeoDataLineString.h>
 
 // Qt includes
 #include <QObject>
@@ -33,7 +32,7 @@ class TracksLayer : public QObject, public Marble::LayerInterface
 public:
     TracksLayer(QObject *parent, GeoDataModel *geoDataModel, QPen *trackPen);
     QStringList renderPosition() const override;
-    bool render(Marble::GeoPainter *painter, Marble::ViewportParams *,
+    bool render(Marble::GeoPainter *painter, Marble::ViewportParams *viewport,
                 const QString &, Marble::GeoSceneLayer *) override;
 
 private: // Variables
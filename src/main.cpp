@@ -6,8 +6,14 @@
 #include "MainWindow.h"
 #include "SharedObjects.h"
 #include "version.h"
+#include "debugMode.h"
+
+#ifdef DEBUG_MODE
+#include "Logging.h"
+#endif
 
 // KDE includes
+#include <KExiv2/KExiv2>
 #include <KCrash>
 #include <KLocalizedString>
 #include <KAboutData>
@@ -17,8 +23,18 @@
 #include <QDebug>
 #include <QCommandLineParser>
 
+#ifdef DEBUG_MODE
+#include <QElapsedTimer>
+#include <QTimer>
+#endif
+
 int main(int argc, char *argv[])
 {
+#ifdef DEBUG_MODE
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+#endif
+
     QApplication application(argc, argv);
     QApplication::setAttribute(Qt::AA_UseHighDpiPixmaps, true);
 
@@ -53,6 +69,10 @@ int main(int argc, char *argv[])
     aboutData.processCommandLine(&commandLineParser);
     auto pathsToLoad = commandLineParser.positionalArguments();
 
+    // Exiv2 has to be initialized before it's used by multiple threads (which happens when
+    // images are loaded)
+    KExiv2Iface::KExiv2::initializeExiv2();
+
     // Setup all shared objects
     SharedObjects sharedObjects;
 
@@ -60,11 +80,23 @@ int main(int argc, char *argv[])
     auto *mainWindow = new MainWindow(&sharedObjects);
     mainWindow->show();
 
+#ifdef DEBUG_MODE
+    // The first event loop iteration is processed after the main window has actually been shown
+    QTimer::singleShot(0, mainWindow, [&startupTimer]
+    {
+        qCDebug(KGeoTagLog) << "Main window visible after" << startupTimer.elapsed() << "ms";
+    });
+#endif
+
     // Trigger loading of files and/or directories given on the command line
     if (! pathsToLoad.isEmpty()) {
         mainWindow->addPathsFromCommandLine(pathsToLoad);
     }
 
     // Run the QApplication
-    return application.exec();
+    const int result = application.exec();
+
+    KExiv2Iface::KExiv2::cleanupExiv2();
+
+    return result;
 }
@@ -0,0 +1,149 @@
+// SPDX-FileCopyrightText: 2023 Tobias Leupold <tl at stonemx dot de>
+//
+// SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+
+/*
+    Build tool converting the timezone map (timezones.png) and the color-timezone mapping
+    (timezones.json), as created by compile_timezones_data.py, to the run-length encoded binary
+    format described in src/TimeZoneData.h, which KGeoTag can memory map without decoding an
+    image or parsing JSON at runtime.
+
+    Usage: kgeotag_compile_timezones <timezones.png> <timezones.json> <timezones.bin>
+*/
+
+// Local includes
+#include "TimeZoneData.h"
+
+// Qt includes
+#include <QCoreApplication>
+#include <QImage>
+#include <QColor>
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QHash>
+#include <QVector>
+#include <QByteArray>
+#include <QTextStream>
+#include <QtEndian>
+
+// C++ includes
+#include <limits>
+
+static bool writePadded(QSaveFile &file, const void *data, qint64 size)
+{
+    static const char padding[8] = {};
+    return file.write(static_cast<const char *>(data), size) == size
+           && file.write(padding, TimeZoneData::padded(size) - size)
+              == TimeZoneData::padded(size) - size;
+}
+
+template<typename T>
+static bool writeArray(QSaveFile &file, QVector<T> data)
+{
+    // The data is always written in little endian byte order, no matter which host we run on
+    qToLittleEndian<T>(data.constData(), data.count(), data.data());
+    return writePadded(file, data.constData(), data.count() * qint64(sizeof(T)));
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QTextStream err(stderr);
+
+    const auto arguments = QCoreApplication::arguments();
+    if (arguments.count() != 4) {
+        err << "Usage: " << arguments.at(0) << " <timezones.png> <timezones.json> <timezones.bin>"
+            << '\n';
+        return 1;
+    }
+
+    // Read the color-timezone mapping
+
+    QFile jsonFile(arguments.at(2));
+    if (! jsonFile.open(QIODevice::ReadOnly)) {
+        err << "Could not open " << arguments.at(2) << '\n';
+        return 1;
+    }
+    const auto mapping = QJsonDocument::fromJson(jsonFile.readAll()).object();
+    if (mapping.isEmpty() || mapping.count() >= std::numeric_limits<quint16>::max()) {
+        err << "Could not read the timezone mapping from " << arguments.at(2) << '\n';
+        return 1;
+    }
+
+    QHash<QRgb, quint16> colorIndices;
+    QVector<quint32> idOffsets;
+    QByteArray idData;
+    for (auto it = mapping.constBegin(); it != mapping.constEnd(); it++) {
+        idOffsets.append(idData.size());
+        idData.append(it.value().toString().toUtf8());
+        colorIndices.insert(QColor(it.key()).rgb() & RGB_MASK, idOffsets.count());
+    }
+    idOffsets.append(idData.size());
+
+    // Read the map and encode it row by row
+
+    auto image = QImage(arguments.at(1));
+    if (image.isNull() || image.width() > std::numeric_limits<quint16>::max()) {
+        err << "Could not read a usable timezone map from " << arguments.at(1) << '\n';
+        return 1;
+    }
+    image = image.convertToFormat(QImage::Format_ARGB32);
+
+    QVector<quint32> rowStarts;
+    QVector<quint16> runEnds;
+    QVector<quint16> runZones;
+
+    for (int y = 0; y < image.height(); y++) {
+        rowStarts.append(runEnds.count());
+        const auto *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        quint16 zone = colorIndices.value(line[0] & RGB_MASK, 0);
+        for (int x = 1; x < image.width(); x++) {
+            const quint16 pixelZone = colorIndices.value(line[x] & RGB_MASK, 0);
+            if (pixelZone != zone) {
+                runEnds.append(x);
+                runZones.append(zone);
+                zone = pixelZone;
+            }
+        }
+        runEnds.append(image.width());
+        runZones.append(zone);
+    }
+    rowStarts.append(runEnds.count());
+
+    // Write the compiled data
+
+    const qint32 zoneCount = idOffsets.count() - 1;
+    const qint32 runCount = runEnds.count();
+
+    TimeZoneData::Header header;
+    header.magic = qToLittleEndian(TimeZoneData::magic);
+    header.version = qToLittleEndian(TimeZoneData::version);
+    header.width = qToLittleEndian(qint32(image.width()));
+    header.height = qToLittleEndian(qint32(image.height()));
+    header.zoneCount = qToLittleEndian(zoneCount);
+    header.idDataLength = qToLittleEndian(qint32(idData.size()));
+    header.runCount = qToLittleEndian(runCount);
+    header.reserved = 0;
+
+    QSaveFile file(arguments.at(3));
+    if (! file.open(QIODevice::WriteOnly)
+        || ! writePadded(file, &header, sizeof(TimeZoneData::Header))
+        || ! writeArray(file, rowStarts)
+        || ! writeArray(file, runEnds)
+        || ! writeArray(file, runZones)
+        || ! writeArray(file, idOffsets)
+        || ! writePadded(file, idData.constData(), idData.size())
+        || ! file.commit()) {
+
+        err << "Could not write " << arguments.at(3) << '\n';
+        return 1;
+    }
+
+    QTextStream(stdout) << "Compiled " << zoneCount << " timezones and " << runCount
+                        << " runs for a " << image.width() << "x" << image.height() << " map to "
+                        << arguments.at(3) << '\n';
+
+    return 0;
+}